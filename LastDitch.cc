@@ -1,40 +1,289 @@
 #include "LastDitch.h"
 
 #include <chrono>
+#include <sstream>
+#include <thread>
+#include <osg/Timer>
 #include "src/Constants.h"
+#include "src/Counters.h"
+#include "src/Log.h"
+#include "src/Memory.h"
+#include "src/Profiler.h"
 
 using namespace ld;
 using namespace osg;
 using namespace std;
 
-LastDitch::LastDitch()
-  : root(new Group),
+LastDitch::LastDitch(const Options& options_)
+  : options(options_),
+    replay_system(options.record_file, options.replay_file),
+    seed(
+      replay_system.is_playing() ? replay_system.get_seed() :
+      SEED > 0 ? SEED : chrono::high_resolution_clock::now().time_since_epoch().count()),
+    root(new Group),
     input(),
-    rng(SEED > 0 ? SEED : chrono::high_resolution_clock::now().time_since_epoch().count()),
+    shared_input(),
+    input_mutex(),
+    rng(seed),
     time_system(),
+    job_system(),
     map_system(rng),
     entity_system(rng, input, map_system),
-    physics_system(input, entity_system, map_system),
-    render_system(root, entity_system, map_system),
-    camera_system(root, input, entity_system)
+    agent_system(rng, job_system, map_system),
+    physics_system(input, job_system, entity_system, agent_system, map_system),
+    hash_system(
+      options.hash_log_file, options.hash_verify_file,
+      job_system, map_system, entity_system, agent_system),
+    render_system(),
+    camera_system(),
+    frame_graph(job_system),
+    snapshots(),
+    running(true),
+    dt(0),
+    tick(0)
 {
-  printf("Last Ditch starting...\n");
+  setup_frame_graph();
 
-  while (camera_system.is_running())
+  replay_system.start_recording(seed);
+
+  if (options.headless)
+  {
+    printf("Last Ditch starting headless...\n");
+
+    run_headless();
+  }
+  else
   {
-    auto dt = time_system.tick();
+    render_system.reset(new RenderSystem(root, entity_system, map_system));
+    camera_system.reset(new CameraSystem(root, shared_input, input_mutex));
+    camera_system->set_realize_handler(
+      [this](GraphicsContext* context) { render_system->check_texture_support(context); });
+
+    printf("Last Ditch starting...\n");
+
+    publish();
+
+    thread simulation_thread(&LastDitch::run_simulation, this);
 
-    entity_system.update();
-    physics_system.update(dt);
-    render_system.update();
-    camera_system.update();
+    run_render();
+
+    running = false;
+    simulation_thread.join();
   }
+
+  MemoryTracker::report();
+
+  if (render_system) render_system->report_objects();
+
+  if (Profiler::instance().is_enabled())
+    Profiler::instance().dump(PROFILER_OUTPUT);
 }
 
 
-int main()
+bool LastDitch::simulate()
 {
-  setbuf(stdout, NULL);
+  PROFILE_SCOPE("LastDitch::simulate");
+
+  {
+    lock_guard<mutex> lock(input_mutex);
+
+    input = shared_input;
+    shared_input.clear_actions();
+  }
+
+  if (replay_system.is_playing())
+  {
+    if (!replay_system.playback(input, dt)) return false;
+  }
+  else
+    replay_system.record(input, dt);
+
+  frame_graph.run();
+
+  return true;
+}
+
+
+void LastDitch::run_simulation()
+{
+  Timer timer;
+  auto start = timer.tick();
+  auto replaying = replay_system.is_playing();
+
+  while (running)
+  {
+    dt = time_system.tick();
+
+    if (!simulate()) break;
+
+    publish();
+
+    time_system.end_tick();
+    MemoryTracker::end_frame();
+
+    if (replaying) continue;
+
+    PROFILE_SCOPE("TimeSystem::wait");
+
+    time_system.wait(is_active());
+  }
+
+  if (replaying)
+  {
+    report_ticks("Replay", replay_system.get_ticks(), timer.delta_s(start, timer.tick()));
+
+    running = false;
+  }
+}
+
+
+void LastDitch::run_headless()
+{
+  Timer timer;
+  auto start = timer.tick();
+  auto replaying = replay_system.is_playing();
+
+  unsigned long long ticks = 0;
+
+  for (; replaying || ticks < options.ticks; ++ticks)
+  {
+    time_system.tick();
+
+    dt = FIXED_TIMESTEP;
+    if (!simulate()) break;
+
+    time_system.end_tick();
+    MemoryTracker::end_frame();
+  }
+
+  report_ticks("Headless", ticks, timer.delta_s(start, timer.tick()));
+}
+
+
+void LastDitch::report_ticks(const string& name, unsigned long long ticks, double elapsed)
+{
+  printf(
+    "%s: %llu ticks in %.3f s, %.1f ticks/s\n",
+    name.c_str(), ticks, elapsed, elapsed > 0 ? ticks / elapsed : 0.0);
+}
+
+
+void LastDitch::run_render()
+{
+  const auto timeout = IDLE_FRAME_RATE > 0 ? 1.0 / IDLE_FRAME_RATE : 0.0;
+
+  while (camera_system->is_running() && running)
+  {
+    snapshots.acquire(timeout);
+
+    const auto& snapshot = snapshots.get_read_buffer();
+
+    render_system->update(snapshot);
+    camera_system->update(snapshot);
+
+    Counters::add(COUNTER_RENDER_FRAMES);
+  }
+}
+
+
+void LastDitch::publish()
+{
+  auto& snapshot = snapshots.get_write_buffer();
+
+  snapshot.tick = tick++;
+
+  for (const auto& key_value : entity_system.get_users())
+  {
+    const auto& user = key_value.second;
+    auto& state = snapshot.users[key_value.first];
+
+    state.matrix = user.matrix;
+    state.position = user.position;
+    state.heading = user.heading;
+    state.pitch = user.pitch;
+  }
+
+  const auto& doors = entity_system.get_doors();
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    snapshot.doors[floor].resize(doors[floor].size());
+
+    for (size_t i = 0; i < doors[floor].size(); ++i)
+      snapshot.doors[floor][i] = DoorState(doors[floor][i].open, doors[floor][i].locked);
+  }
+
+  if (snapshot.doors_version != entity_system.get_doors_version())
+  {
+    snapshot.doors_version = entity_system.get_doors_version();
+    snapshot.door_layout = doors;
+  }
+
+  const auto& user = entity_system.get_user("kadijah");
+
+  // Debug user position
+  std::ostringstream ss;
+  ss.precision(1);
+  ss.setf(std::ios::fixed);
+  ss << user.position.x() << " " << user.position.y() << " " << user.position.z();
+
+  // Frame time distribution over the last stats window
+  const auto& frames = time_system.get_frame_report();
+  ss.precision(2);
+  ss << "\nframe p50 " << frames.p50 << " p99 " << frames.p99 << " max " << frames.max;
+  ss << " ms, " << frames.hitches << " hitches";
+
+  snapshot.hud_text = ss.str();
+
+  snapshots.publish();
+}
+
+
+bool LastDitch::is_active()
+{
+  auto active =
+    input.activity ||
+    input.forward || input.backward || input.left || input.right ||
+    entity_system.get_user("kadijah").inactive_time > 0.0;
+
+  input.activity = false;
+
+  return active;
+}
+
+
+void LastDitch::setup_frame_graph()
+{
+  frame_graph.add(
+    "entities", EntitySystem::READS, EntitySystem::WRITES,
+    [this]() { entity_system.update(); });
+
+  frame_graph.add(
+    "agents", AgentSystem::READS, AgentSystem::WRITES,
+    [this]() { agent_system.update(); });
+
+  frame_graph.add(
+    "physics", PhysicsSystem::READS, PhysicsSystem::WRITES,
+    [this]() { physics_system.update(dt); });
+
+  if (hash_system.is_enabled())
+    frame_graph.add(
+      "hash", HashSystem::READS, HashSystem::WRITES,
+      [this]() { hash_system.update(); });
+}
+
+
+int main(int argc, char** argv)
+{
+  MemoryTracker::set_debug(MEMORY_DEBUG);
+
+  Logger::instance().start(LOG_OUTPUT);
+  Counters::instance().open(COUNTERS_NAME);
+
+  {
+    LastDitch app(parse_options(argc, argv));
+  }
 
-  LastDitch app;
+  Counters::instance().close();
+  Logger::instance().stop();
 }
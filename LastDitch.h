@@ -1,13 +1,23 @@
 #ifndef LASTDITCH_H
 #define LASTDITCH_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <osg/Group>
+#include "src/Options.h"
+#include "src/TripleBuffer.h"
 #include "src/components/Input.h"
+#include "src/components/Snapshot.h"
 #include "src/systems/TimeSystem.h"
+#include "src/systems/ReplaySystem.h"
+#include "src/systems/JobSystem.h"
 #include "src/systems/MapSystem.h"
 #include "src/systems/EntitySystem.h"
+#include "src/systems/AgentSystem.h"
 #include "src/systems/PhysicsSystem.h"
+#include "src/systems/HashSystem.h"
 #include "src/systems/RenderSystem.h"
 #include "src/systems/CameraSystem.h"
 
@@ -16,21 +26,54 @@ namespace ld
 
 class LastDitch
 {
+  Options options;
+
+  ReplaySystem replay_system;
+
+  unsigned long long seed;
+
   osg::ref_ptr<osg::Group> root;
 
   Input input;
+  Input shared_input;
+  std::mutex input_mutex;
 
   std::mt19937 rng;
 
   TimeSystem time_system;
+  JobSystem job_system;
   MapSystem map_system;
   EntitySystem entity_system;
+  AgentSystem agent_system;
   PhysicsSystem physics_system;
-  RenderSystem render_system;
-  CameraSystem camera_system;
+  HashSystem hash_system;
+  std::unique_ptr<RenderSystem> render_system;
+  std::unique_ptr<CameraSystem> camera_system;
+
+  TaskGraph frame_graph;
+  TripleBuffer<Snapshot> snapshots;
+
+  std::atomic<bool> running;
+
+  double dt;
+  unsigned long long tick;
+
+  void setup_frame_graph();
+
+  bool simulate();
+
+  void run_simulation();
+  void run_render();
+  void run_headless();
+
+  void report_ticks(const std::string& name, unsigned long long ticks, double elapsed);
+
+  void publish();
+
+  bool is_active();
 
 public:
-  LastDitch();
+  LastDitch(const Options& options);
 };
 
 }
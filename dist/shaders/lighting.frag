@@ -0,0 +1,65 @@
+#version 120
+
+// Must match MAX_SHADER_CLUSTER_LIGHTS in ClusteredLighting.h
+const int MAX_CLUSTER_LIGHTS = 64;
+
+uniform sampler2D diffuse_map;
+
+// Row 0 holds position and radius, row 1 colour
+uniform sampler2D light_map;
+// Number of lights listed in each cluster
+uniform sampler2D cluster_counts;
+// max_cluster_lights light indices per cluster, one row per grid row
+uniform sampler2D cluster_lights;
+
+uniform vec2 cluster_origin;
+uniform float cluster_extent;
+uniform float cluster_grid_size;
+uniform float max_cluster_lights;
+uniform float light_map_size;
+uniform vec3 ambient;
+
+varying vec3 world_position;
+varying vec3 world_normal;
+
+void main()
+{
+	vec4 base = texture2D(diffuse_map, gl_TexCoord[0].st) * gl_FrontMaterial.diffuse;
+	vec3 normal = normalize(world_normal);
+	vec3 color = ambient;
+
+	vec2 cluster = floor((world_position.xy - cluster_origin) / cluster_extent);
+
+	bool inside =
+		all(greaterThanEqual(cluster, vec2(0.0))) &&
+		all(lessThan(cluster, vec2(cluster_grid_size)));
+
+	if (inside)
+	{
+		float count = texture2D(cluster_counts, (cluster + 0.5) / cluster_grid_size).r;
+
+		float row = (cluster.y + 0.5) / cluster_grid_size;
+		float first = cluster.x * max_cluster_lights;
+		float width = cluster_grid_size * max_cluster_lights;
+
+		for (int i = 0; i < MAX_CLUSTER_LIGHTS; ++i)
+		{
+			if (float(i) >= count) break;
+
+			float light = texture2D(cluster_lights, vec2((first + float(i) + 0.5) / width, row)).r;
+			float u = (light + 0.5) / light_map_size;
+
+			vec4 position_radius = texture2D(light_map, vec2(u, 0.25));
+			vec3 light_color = texture2D(light_map, vec2(u, 0.75)).rgb;
+
+			vec3 to_light = position_radius.xyz - world_position;
+			float light_distance = max(length(to_light), 0.0001);
+			float falloff = clamp(1.0 - light_distance / position_radius.w, 0.0, 1.0);
+			float diffuse = max(dot(normal, to_light / light_distance), 0.0);
+
+			color += light_color * falloff * falloff * diffuse;
+		}
+	}
+
+	gl_FragColor = vec4(base.rgb * color, base.a);
+}
@@ -0,0 +1,18 @@
+#version 120
+
+// Supplied by osgUtil::SceneView
+uniform mat4 osg_ViewMatrixInverse;
+
+varying vec3 world_position;
+varying vec3 world_normal;
+
+void main()
+{
+	vec4 eye_position = gl_ModelViewMatrix * gl_Vertex;
+
+	world_position = (osg_ViewMatrixInverse * eye_position).xyz;
+	world_normal = mat3(osg_ViewMatrixInverse) * (gl_NormalMatrix * gl_Normal);
+
+	gl_TexCoord[0] = gl_MultiTexCoord0;
+	gl_Position = gl_ProjectionMatrix * eye_position;
+}
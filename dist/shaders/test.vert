@@ -2,5 +2,5 @@
 
 void main()
 {
-	gl_Position = position;
+	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
 }
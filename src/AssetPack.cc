@@ -0,0 +1,328 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <streambuf>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <osgDB/FileNameUtils>
+#include "Profiler.h"
+
+using namespace ld;
+using namespace std;
+
+static const char PACK_MAGIC[4] = {'L', 'D', 'P', 'K'};
+
+REGISTER_OSGPLUGIN(ldpk, AssetPack)
+
+// Read only stream buffer over a range of the mapping
+class MemoryBuffer : public streambuf
+{
+public:
+  MemoryBuffer(const char* begin, size_t size)
+  {
+    auto data = const_cast<char*>(begin);
+
+    setg(data, data, data + size);
+  }
+
+protected:
+  virtual pos_type seekoff(off_type offset, ios_base::seekdir dir, ios_base::openmode)
+  {
+    auto base = dir == ios_base::beg ? eback() : dir == ios_base::cur ? gptr() : egptr();
+    auto target = base + offset;
+
+    if (target < eback() || target > egptr()) return pos_type(off_type(-1));
+
+    setg(eback(), target, egptr());
+
+    return pos_type(target - eback());
+  }
+
+  virtual pos_type seekpos(pos_type position, ios_base::openmode)
+  {
+    return seekoff(off_type(position), ios_base::beg, ios_base::in);
+  }
+};
+
+
+AssetPack::AssetPack()
+  : archive_name(),
+    data(nullptr),
+    size(0),
+    header(nullptr),
+    entries(nullptr),
+    names(nullptr)
+{
+  supportsExtension("ldpk", "LastDitch asset pack");
+
+  osgDB::Registry::instance()->addArchiveExtension("ldpk");
+}
+
+
+AssetPack::~AssetPack()
+{
+  close();
+}
+
+
+bool AssetPack::open(const std::string& file_name)
+{
+  close();
+
+  auto fd = ::open(file_name.c_str(), O_RDONLY);
+
+  if (fd < 0) return false;
+
+  struct stat info;
+
+  auto mapped =
+    fstat(fd, &info) == 0 &&
+    (size_t)info.st_size >= sizeof(PackHeader) &&
+    (data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED;
+
+  ::close(fd);
+
+  if (!mapped)
+  {
+    printf("AssetPack: could not map %s\n", file_name.c_str());
+
+    data = nullptr;
+    return false;
+  }
+
+  size = info.st_size;
+  header = static_cast<const PackHeader*>(data);
+  entries = reinterpret_cast<const PackEntry*>(header + 1);
+  names = reinterpret_cast<const char*>(entries + header->num_entries);
+
+  auto valid =
+    memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+    header->version == PACK_VERSION &&
+    (size_t)(names + header->names_size - static_cast<const char*>(data)) <= size;
+
+  for (uint32_t i = 0; valid && i < header->num_entries; ++i)
+  {
+    valid =
+      entries[i].offset + entries[i].size <= size &&
+      entries[i].name_offset + entries[i].name_size <= header->names_size;
+  }
+
+  if (!valid)
+  {
+    printf("AssetPack: %s is not a pack this build understands\n", file_name.c_str());
+
+    close();
+    return false;
+  }
+
+  archive_name = file_name;
+
+  printf("AssetPack: %u files in %s\n", header->num_entries, file_name.c_str());
+
+  return true;
+}
+
+
+void AssetPack::close()
+{
+  if (!data) return;
+
+  munmap(data, size);
+
+  data = nullptr;
+  size = 0;
+  header = nullptr;
+  entries = nullptr;
+  names = nullptr;
+  archive_name.clear();
+}
+
+
+std::string AssetPack::get_name(const PackEntry& entry) const
+{
+  return std::string(names + entry.name_offset, entry.name_size);
+}
+
+
+// Entries are named relative to the media directory, but loaders that
+// resolve names through osgDB::findDataFile first, like osgText for fonts,
+// ask for them with a data path in front
+const PackEntry* AssetPack::find(const std::string& file_name) const
+{
+  if (!data) return nullptr;
+
+  if (auto entry = find_entry(file_name)) return entry;
+
+  for (auto path : osgDB::Registry::instance()->getDataFilePathList())
+  {
+    if (path.empty()) continue;
+    if (path.back() != '/') path += '/';
+
+    if (file_name.size() <= path.size() || file_name.compare(0, path.size(), path) != 0)
+      continue;
+
+    if (auto entry = find_entry(file_name.substr(path.size()))) return entry;
+  }
+
+  return nullptr;
+}
+
+
+const PackEntry* AssetPack::find_entry(const std::string& name) const
+{
+  auto end = entries + header->num_entries;
+
+  auto entry = lower_bound(
+    entries, end, name,
+    [this](const PackEntry& entry, const std::string& key)
+    {
+      return key.compare(0, string::npos, names + entry.name_offset, entry.name_size) > 0;
+    });
+
+  if (entry == end) return nullptr;
+
+  if (name.compare(0, string::npos, names + entry->name_offset, entry->name_size) != 0)
+    return nullptr;
+
+  return entry;
+}
+
+
+bool AssetPack::fileExists(const std::string& file_name) const
+{
+  return find(file_name) != nullptr;
+}
+
+
+osgDB::FileType AssetPack::getFileType(const std::string& file_name) const
+{
+  if (find(file_name)) return osgDB::REGULAR_FILE;
+
+  if (!data) return osgDB::FILE_NOT_FOUND;
+
+  auto prefix = file_name + "/";
+
+  for (uint32_t i = 0; i < header->num_entries; ++i)
+  {
+    if (get_name(entries[i]).compare(0, prefix.size(), prefix) == 0)
+      return osgDB::DIRECTORY;
+  }
+
+  return osgDB::FILE_NOT_FOUND;
+}
+
+
+bool AssetPack::getFileNames(FileNameList& file_names) const
+{
+  if (!data) return false;
+
+  for (uint32_t i = 0; i < header->num_entries; ++i)
+    file_names.push_back(get_name(entries[i]));
+
+  return true;
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::openArchive(
+  const std::string& file_name, ArchiveStatus status, unsigned, const Options*) const
+{
+  if (!acceptsExtension(osgDB::getLowerCaseFileExtension(file_name)))
+    return ReadResult::FILE_NOT_HANDLED;
+
+  if (status != READ) return ReadResult::FILE_NOT_HANDLED;
+
+  osg::ref_ptr<AssetPack> pack = new AssetPack;
+
+  if (!pack->open(file_name)) return ReadResult::FILE_NOT_FOUND;
+
+  return pack.get();
+}
+
+
+// Hands the entry to the plugin for its extension as a stream over the
+// mapping
+template <typename Read>
+osgDB::ReaderWriter::ReadResult AssetPack::read(
+  const std::string& file_name, const Options* options, Read read) const
+{
+  PROFILE_SCOPE("AssetPack::read");
+
+  auto entry = find(file_name);
+
+  if (!entry) return ReadResult::FILE_NOT_FOUND;
+
+  auto reader_writer = osgDB::Registry::instance()->getReaderWriterForExtension(
+    osgDB::getLowerCaseFileExtension(file_name));
+
+  if (!reader_writer) return ReadResult::FILE_NOT_HANDLED;
+
+  MemoryBuffer buffer(static_cast<const char*>(data) + entry->offset, entry->size);
+  istream stream(&buffer);
+
+  return read(*reader_writer, stream, options);
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::readObject(
+  const std::string& file_name, const Options* options) const
+{
+  return read(
+    file_name, options,
+    [](ReaderWriter& reader_writer, istream& stream, const Options* options)
+    {
+      return reader_writer.readObject(stream, options);
+    });
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::readImage(
+  const std::string& file_name, const Options* options) const
+{
+  return read(
+    file_name, options,
+    [](ReaderWriter& reader_writer, istream& stream, const Options* options)
+    {
+      return reader_writer.readImage(stream, options);
+    });
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::readHeightField(
+  const std::string& file_name, const Options* options) const
+{
+  return read(
+    file_name, options,
+    [](ReaderWriter& reader_writer, istream& stream, const Options* options)
+    {
+      return reader_writer.readHeightField(stream, options);
+    });
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::readNode(
+  const std::string& file_name, const Options* options) const
+{
+  return read(
+    file_name, options,
+    [](ReaderWriter& reader_writer, istream& stream, const Options* options)
+    {
+      return reader_writer.readNode(stream, options);
+    });
+}
+
+
+osgDB::ReaderWriter::ReadResult AssetPack::readShader(
+  const std::string& file_name, const Options* options) const
+{
+  return read(
+    file_name, options,
+    [](ReaderWriter& reader_writer, istream& stream, const Options* options)
+    {
+      return reader_writer.readShader(stream, options);
+    });
+}
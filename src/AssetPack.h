@@ -0,0 +1,132 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <cstdint>
+#include <string>
+#include <osgDB/Archive>
+#include <osgDB/Registry>
+
+namespace ld
+{
+
+// A pack is a PackHeader, then one PackEntry per file sorted by name, then
+// the names, then each file's contents starting on a PACK_ALIGNMENT
+// boundary. Readers map the whole pack and hand plugins streams over the
+// mapping, so assets are parsed without being copied or opened one by one.
+static constexpr uint32_t PACK_VERSION = 1;
+static constexpr uint64_t PACK_ALIGNMENT = 4096;
+
+struct PackHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t num_entries;
+  uint32_t names_size;
+};
+
+struct PackEntry
+{
+  uint64_t offset;
+  uint64_t size;
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+class AssetPack : public osgDB::Archive
+{
+  const PackEntry* find(const std::string& file_name) const;
+  const PackEntry* find_entry(const std::string& name) const;
+  std::string get_name(const PackEntry& entry) const;
+
+  template <typename Read>
+  ReadResult read(const std::string& file_name, const Options* options, Read read) const;
+
+  std::string archive_name;
+
+  void* data;
+  size_t size;
+
+  const PackHeader* header;
+  const PackEntry* entries;
+  const char* names;
+
+public:
+  AssetPack();
+  ~AssetPack();
+
+  bool open(const std::string& file_name);
+
+  virtual const char* className() const { return "LastDitch asset pack"; }
+
+  virtual void close();
+
+  virtual bool fileExists(const std::string& file_name) const;
+  virtual osgDB::FileType getFileType(const std::string& file_name) const;
+  virtual bool getFileNames(FileNameList& file_names) const;
+
+  virtual std::string getArchiveFileName() const { return archive_name; }
+  virtual std::string getMasterFileName() const { return ""; }
+
+  virtual ReadResult openArchive(
+    const std::string& file_name, ArchiveStatus status,
+    unsigned buffer_size, const Options* options) const;
+
+  virtual ReadResult readObject(const std::string& file_name, const Options* options) const;
+  virtual ReadResult readImage(const std::string& file_name, const Options* options) const;
+  virtual ReadResult readHeightField(const std::string& file_name, const Options* options) const;
+  virtual ReadResult readNode(const std::string& file_name, const Options* options) const;
+  virtual ReadResult readShader(const std::string& file_name, const Options* options) const;
+
+  // Packs are built offline by LastDitchPacker and never written at runtime
+  virtual WriteResult writeObject(
+    const osg::Object&, const std::string&, const Options*) const { return WriteResult::FILE_NOT_HANDLED; }
+  virtual WriteResult writeImage(
+    const osg::Image&, const std::string&, const Options*) const { return WriteResult::FILE_NOT_HANDLED; }
+  virtual WriteResult writeHeightField(
+    const osg::HeightField&, const std::string&, const Options*) const { return WriteResult::FILE_NOT_HANDLED; }
+  virtual WriteResult writeNode(
+    const osg::Node&, const std::string&, const Options*) const { return WriteResult::FILE_NOT_HANDLED; }
+  virtual WriteResult writeShader(
+    const osg::Shader&, const std::string&, const Options*) const { return WriteResult::FILE_NOT_HANDLED; }
+};
+
+
+// Serves reads from the pack when it holds the file and from the file
+// system otherwise, so callers keep using the same relative paths
+class AssetPackReadCallback : public osgDB::ReadFileCallback
+{
+  osg::ref_ptr<AssetPack> pack;
+
+public:
+  AssetPackReadCallback(AssetPack* pack_)
+    : pack(pack_)
+  {}
+
+  virtual osgDB::ReaderWriter::ReadResult readObject(
+    const std::string& file_name, const osgDB::Options* options)
+  {
+    if (pack->fileExists(file_name)) return pack->readObject(file_name, options);
+
+    return osgDB::ReadFileCallback::readObject(file_name, options);
+  }
+
+  virtual osgDB::ReaderWriter::ReadResult readImage(
+    const std::string& file_name, const osgDB::Options* options)
+  {
+    if (pack->fileExists(file_name)) return pack->readImage(file_name, options);
+
+    return osgDB::ReadFileCallback::readImage(file_name, options);
+  }
+
+  virtual osgDB::ReaderWriter::ReadResult readNode(
+    const std::string& file_name, const osgDB::Options* options)
+  {
+    if (pack->fileExists(file_name)) return pack->readNode(file_name, options);
+
+    return osgDB::ReadFileCallback::readNode(file_name, options);
+  }
+};
+
+}
+
+#endif /* ASSETPACK_H */
@@ -0,0 +1,92 @@
+#include "CharacterAssembler.h"
+
+#include <algorithm>
+#include <cstring>
+#include "GeometryMerger.h"
+#include "Profiler.h"
+
+using namespace ld;
+using namespace osg;
+
+CharacterAssembler::CharacterAssembler()
+  : parts()
+{}
+
+
+void CharacterAssembler::add_part(Node* model, Image* image)
+{
+  parts.push_back({model, image});
+}
+
+
+// Textures are stacked bottom to top, each at the atlas's left edge
+Image* CharacterAssembler::build_atlas(std::map<const Image*, AtlasRegion>& regions) const
+{
+  std::vector<const Image*> images;
+
+  for (const auto& part : parts)
+    if (std::find(images.begin(), images.end(), part.image.get()) == images.end())
+      images.push_back(part.image.get());
+
+  auto width = 0;
+  auto height = 0;
+
+  for (auto image : images)
+  {
+    width = std::max(width, image->s());
+    height += image->t();
+  }
+
+  auto atlas = new Image;
+  atlas->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+  memset(atlas->data(), 0, atlas->getTotalSizeInBytes());
+
+  auto y = 0;
+
+  for (auto image : images)
+  {
+    if (image->getPixelFormat() == GL_RGBA && image->getDataType() == GL_UNSIGNED_BYTE)
+    {
+      atlas->copySubImage(0, y, 0, image);
+    }
+    else
+    {
+      for (auto t = 0; t < image->t(); ++t)
+	for (auto s = 0; s < image->s(); ++s)
+	  atlas->setColor(image->getColor(s, t), s, y + t);
+    }
+
+    auto& region = regions[image];
+    region.offset = Vec2(0.f, (float)y / height);
+    region.scale = Vec2((float)image->s() / width, (float)image->t() / height);
+
+    y += image->t();
+  }
+
+  return atlas;
+}
+
+
+ref_ptr<Geometry> CharacterAssembler::assemble(ref_ptr<Image>& atlas) const
+{
+  PROFILE_SCOPE("CharacterAssembler::assemble");
+
+  for (const auto& part : parts)
+    if (!part.model || !part.image || part.image->isCompressed()) return nullptr;
+
+  std::map<const Image*, AtlasRegion> regions;
+
+  atlas = build_atlas(regions);
+
+  GeometryMerger merger;
+
+  for (const auto& part : parts)
+  {
+    const auto& region = regions[part.image.get()];
+
+    merger.add(part.model, Matrix(), region.offset, region.scale);
+  }
+
+  return merger.get_geometry();
+}
@@ -0,0 +1,56 @@
+#ifndef CHARACTERASSEMBLER_H
+#define CHARACTERASSEMBLER_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <osg/Geometry>
+#include <osg/Image>
+#include <osg/Node>
+
+namespace ld
+{
+
+// A model drawn with a texture, both named without directory or extension
+struct CharacterPart
+{
+  std::string model;
+  std::string texture;
+};
+
+// Bakes a character's body and accessories into a single Geometry drawn
+// with a single texture. The distinct textures of the parts are stacked
+// into one atlas image, and each part's texture coordinates are remapped
+// into its texture's region, so they are expected to stay within the unit
+// square. Transforms inside the models are applied to the vertices, and
+// all primitives become one indexed triangle list.
+class CharacterAssembler
+{
+  struct Part
+  {
+    osg::ref_ptr<osg::Node> model;
+    osg::ref_ptr<osg::Image> image;
+  };
+
+  struct AtlasRegion
+  {
+    osg::Vec2 offset;
+    osg::Vec2 scale;
+  };
+
+  osg::Image* build_atlas(std::map<const osg::Image*, AtlasRegion>& regions) const;
+
+  std::vector<Part> parts;
+
+public:
+  CharacterAssembler();
+
+  void add_part(osg::Node* model, osg::Image* image);
+
+  // Returns nullptr, with atlas unset, if a part is missing
+  osg::ref_ptr<osg::Geometry> assemble(osg::ref_ptr<osg::Image>& atlas) const;
+};
+
+}
+
+#endif /* CHARACTERASSEMBLER_H */
@@ -0,0 +1,47 @@
+#include "ChunkReaderWriter.h"
+
+#include <cstdio>
+#include <osgDB/FileNameUtils>
+#include "Memory.h"
+#include "Profiler.h"
+#include "systems/MapSystem.h"
+#include "systems/RenderSystem.h"
+
+using namespace ld;
+using namespace osg;
+
+ChunkReaderWriter::ChunkReaderWriter(RenderSystem& render_system_)
+  : render_system(render_system_)
+{
+  supportsExtension("ldchunk", "LastDitch map chunk");
+}
+
+
+std::string ChunkReaderWriter::get_file_name(int chunk, int floor)
+{
+  return std::to_string(chunk) + "-" + std::to_string(floor) + ".ldchunk";
+}
+
+
+osgDB::ReaderWriter::ReadResult ChunkReaderWriter::readNode(
+  const std::string& file_name, const Options*) const
+{
+  if (!acceptsExtension(osgDB::getLowerCaseFileExtension(file_name)))
+    return ReadResult::FILE_NOT_HANDLED;
+
+  PROFILE_SCOPE("ChunkReaderWriter::readNode");
+  MEMORY_SCOPE(MEMORY_RENDER);
+
+  int chunk, floor;
+
+  auto name = osgDB::getSimpleFileName(file_name);
+
+  if (sscanf(name.c_str(), "%d-%d", &chunk, &floor) != 2 ||
+      chunk < 0 || chunk >= CHUNKS_PER_SIDE * CHUNKS_PER_SIDE ||
+      floor < 0 || floor >= NUM_FLOORS)
+  {
+    return ReadResult::FILE_NOT_FOUND;
+  }
+
+  return render_system.build_chunk(chunk, floor).get();
+}
@@ -0,0 +1,31 @@
+#ifndef CHUNKREADERWRITER_H
+#define CHUNKREADERWRITER_H
+
+#include <string>
+#include <osgDB/ReaderWriter>
+
+namespace ld
+{
+
+class RenderSystem;
+
+// Produces map chunks for the PagedLODs RenderSystem places over the map.
+// Chunks are named "<chunk>-<floor>.ldchunk" and built from the live map
+// on the DatabasePager's threads, so nothing here touches the scene graph.
+class ChunkReaderWriter : public osgDB::ReaderWriter
+{
+  RenderSystem& render_system;
+
+public:
+  ChunkReaderWriter(RenderSystem& render_system);
+
+  static std::string get_file_name(int chunk, int floor);
+
+  virtual const char* className() const { return "LastDitch map chunk loader"; }
+
+  virtual ReadResult readNode(const std::string& file_name, const Options* options) const;
+};
+
+}
+
+#endif /* CHUNKREADERWRITER_H */
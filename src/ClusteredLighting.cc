@@ -0,0 +1,234 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <osgDB/FileUtils>
+#include "Constants.h"
+#include "Profiler.h"
+
+using namespace ld;
+using namespace osg;
+
+static Texture2D* create_data_texture(Image* image)
+{
+  auto texture = new Texture2D(image);
+  texture->setFilter(Texture::MIN_FILTER, Texture::NEAREST);
+  texture->setFilter(Texture::MAG_FILTER, Texture::NEAREST);
+  texture->setWrap(Texture::WRAP_S, Texture::CLAMP_TO_EDGE);
+  texture->setWrap(Texture::WRAP_T, Texture::CLAMP_TO_EDGE);
+  texture->setResizeNonPowerOfTwoHint(false);
+
+  return texture;
+}
+
+
+// One light near the ceiling of every room, reaching just past its walls
+ClusteredLighting::ClusteredLighting(const MapSystem& map_system)
+  : lights(),
+    grid_size(CLUSTER_GRID_SIZE),
+    max_cluster_lights(std::min(MAX_CLUSTER_LIGHTS, MAX_SHADER_CLUSTER_LIGHTS)),
+    cluster_extent(CLUSTER_SIZE * TILE_SIZE),
+    origin_x(INT_MIN),
+    origin_y(INT_MIN),
+    origin_floor(-1),
+    program(new Program),
+    buffers(),
+    current(0)
+{
+  const auto& rooms = map_system.get_rooms();
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    for (const auto& room : rooms[floor])
+    {
+      PointLight light;
+      light.position = Vec3(
+	TILE_SIZE * (room.x + (room.w - 1) / 2.0),
+	TILE_SIZE * (room.y + (room.h - 1) / 2.0),
+	FLOOR_HEIGHT * (floor + .8));
+      light.radius = TILE_SIZE * (std::sqrt(room.w * room.w + room.h * room.h) / 2.0 + 1.0);
+      light.color = Vec3(1.f, .9f, .75f);
+      light.floor = floor;
+
+      lights.push_back(light);
+    }
+  }
+
+  auto vertex =
+    Shader::readShaderFile(Shader::VERTEX, osgDB::findDataFile("shaders/lighting.vert"));
+  auto fragment =
+    Shader::readShaderFile(Shader::FRAGMENT, osgDB::findDataFile("shaders/lighting.frag"));
+
+  if (!vertex || !fragment) printf("Lighting shaders not found\n");
+
+  if (vertex) program->addShader(vertex);
+  if (fragment) program->addShader(fragment);
+
+  for (auto& buffer : buffers)
+    setup_buffer(buffer);
+
+  printf("Clustered lighting: %zu lights\n", lights.size());
+}
+
+
+void ClusteredLighting::setup_buffer(ClusterBuffer& buffer)
+{
+  buffer.light_image = new Image;
+  buffer.light_image->allocateImage(MAX_UPLOADED_LIGHTS, 2, 1, GL_RGBA, GL_FLOAT);
+  buffer.light_image->setInternalTextureFormat(GL_RGBA32F_ARB);
+
+  buffer.count_image = new Image;
+  buffer.count_image->allocateImage(grid_size, grid_size, 1, GL_LUMINANCE, GL_FLOAT);
+  buffer.count_image->setInternalTextureFormat(GL_LUMINANCE32F_ARB);
+
+  buffer.index_image = new Image;
+  buffer.index_image->allocateImage(
+    grid_size * max_cluster_lights, grid_size, 1, GL_LUMINANCE, GL_FLOAT);
+  buffer.index_image->setInternalTextureFormat(GL_LUMINANCE32F_ARB);
+
+  memset(buffer.light_image->data(), 0, buffer.light_image->getTotalSizeInBytes());
+  memset(buffer.count_image->data(), 0, buffer.count_image->getTotalSizeInBytes());
+  memset(buffer.index_image->data(), 0, buffer.index_image->getTotalSizeInBytes());
+
+  buffer.origin_uniform = new Uniform("cluster_origin", Vec2(0.f, 0.f));
+
+  auto state_set = new StateSet;
+
+  state_set->setAttributeAndModes(program);
+
+  state_set->setTextureAttributeAndModes(1, create_data_texture(buffer.light_image));
+  state_set->setTextureAttributeAndModes(2, create_data_texture(buffer.count_image));
+  state_set->setTextureAttributeAndModes(3, create_data_texture(buffer.index_image));
+
+  state_set->addUniform(new Uniform("diffuse_map", 0));
+  state_set->addUniform(new Uniform("light_map", 1));
+  state_set->addUniform(new Uniform("cluster_counts", 2));
+  state_set->addUniform(new Uniform("cluster_lights", 3));
+
+  state_set->addUniform(buffer.origin_uniform);
+  state_set->addUniform(new Uniform("cluster_extent", cluster_extent));
+  state_set->addUniform(new Uniform("cluster_grid_size", (float)grid_size));
+  state_set->addUniform(new Uniform("max_cluster_lights", (float)max_cluster_lights));
+  state_set->addUniform(new Uniform("light_map_size", (float)MAX_UPLOADED_LIGHTS));
+  state_set->addUniform(new Uniform("ambient", Vec3(.1f, .1f, .1f)));
+
+  // Set explicitly, as a dynamic StateSet would make the draw thread hold
+  // up the next frame
+  state_set->setDataVariance(Object::STATIC);
+
+  buffer.state_set = state_set;
+}
+
+
+void ClusteredLighting::update(const Vec3& eye)
+{
+  auto x = (int)std::floor(eye.x() / cluster_extent) - grid_size / 2;
+  auto y = (int)std::floor(eye.y() / cluster_extent) - grid_size / 2;
+  auto floor = std::min(std::max((int)std::floor(eye.z() / FLOOR_HEIGHT), 0), NUM_FLOORS - 1);
+
+  if (x == origin_x && y == origin_y && floor == origin_floor) return;
+
+  origin_x = x;
+  origin_y = y;
+  origin_floor = floor;
+
+  assign();
+}
+
+
+// Lists each light of the camera's floor in the clusters its radius
+// reaches. A cluster that is already full drops further lights, and lights
+// past MAX_UPLOADED_LIGHTS are not uploaded. The buffer written is the one
+// the frame still being drawn does not use; the frame before it, which
+// may have used it, has finished drawing by the time this cull runs.
+void ClusteredLighting::assign()
+{
+  PROFILE_SCOPE("ClusteredLighting::assign");
+
+  auto& buffer = buffers[1 - current];
+
+  auto light_data = reinterpret_cast<float*>(buffer.light_image->data());
+  auto counts = reinterpret_cast<float*>(buffer.count_image->data());
+  auto indices = reinterpret_cast<float*>(buffer.index_image->data());
+
+  std::fill(counts, counts + grid_size * grid_size, 0.f);
+
+  auto min_x = origin_x * cluster_extent;
+  auto min_y = origin_y * cluster_extent;
+  auto max_x = min_x + grid_size * cluster_extent;
+  auto max_y = min_y + grid_size * cluster_extent;
+
+  auto uploaded = 0;
+
+  for (const auto& light : lights)
+  {
+    if (uploaded == MAX_UPLOADED_LIGHTS) break;
+    if (light.floor != origin_floor) continue;
+
+    const auto& position = light.position;
+
+    if (position.x() + light.radius < min_x || position.x() - light.radius > max_x) continue;
+    if (position.y() + light.radius < min_y || position.y() - light.radius > max_y) continue;
+
+    auto local_x = position.x() - min_x;
+    auto local_y = position.y() - min_y;
+
+    auto x1 = std::max((int)std::floor((local_x - light.radius) / cluster_extent), 0);
+    auto y1 = std::max((int)std::floor((local_y - light.radius) / cluster_extent), 0);
+    auto x2 = std::min((int)std::floor((local_x + light.radius) / cluster_extent), grid_size - 1);
+    auto y2 = std::min((int)std::floor((local_y + light.radius) / cluster_extent), grid_size - 1);
+
+    auto listed = false;
+
+    for (auto cy = y1; cy <= y2; ++cy)
+    {
+      for (auto cx = x1; cx <= x2; ++cx)
+      {
+	// Closest point of the cluster to the light
+	auto near_x = std::min(std::max(local_x, cx * cluster_extent), (cx + 1) * cluster_extent);
+	auto near_y = std::min(std::max(local_y, cy * cluster_extent), (cy + 1) * cluster_extent);
+	auto dx = near_x - local_x;
+	auto dy = near_y - local_y;
+
+	if (dx * dx + dy * dy > light.radius * light.radius) continue;
+
+	auto& count = counts[cy * grid_size + cx];
+
+	if (count >= max_cluster_lights) continue;
+
+	auto first = (cy * grid_size + cx) * max_cluster_lights;
+
+	indices[first + (int)count] = uploaded;
+	count += 1.f;
+
+	listed = true;
+      }
+    }
+
+    if (!listed) continue;
+
+    auto data = light_data + 4 * uploaded;
+    data[0] = position.x();
+    data[1] = position.y();
+    data[2] = position.z();
+    data[3] = light.radius;
+
+    data = light_data + 4 * (MAX_UPLOADED_LIGHTS + uploaded);
+    data[0] = light.color.x();
+    data[1] = light.color.y();
+    data[2] = light.color.z();
+    data[3] = 1.f;
+
+    ++uploaded;
+  }
+
+  buffer.origin_uniform->set(Vec2(min_x, min_y));
+
+  buffer.light_image->dirty();
+  buffer.count_image->dirty();
+  buffer.index_image->dirty();
+
+  current = 1 - current;
+}
@@ -0,0 +1,87 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+#include <array>
+#include <vector>
+#include <osg/Image>
+#include <osg/Program>
+#include <osg/Referenced>
+#include <osg/StateSet>
+#include <osg/Texture2D>
+#include <osg/Uniform>
+#include <osg/Vec3>
+#include "systems/MapSystem.h"
+
+namespace ld
+{
+
+// Loop bound of the fragment shader; 'max cluster lights' is capped to it
+static constexpr int MAX_SHADER_CLUSTER_LIGHTS = 64;
+
+// Lights uploaded at once, the width of the light texture
+static constexpr int MAX_UPLOADED_LIGHTS = 1024;
+
+struct PointLight
+{
+  osg::Vec3 position;
+  float radius;
+  osg::Vec3 color;
+  int floor;
+};
+
+// Per pixel lighting for many point lights. Space around the camera is cut
+// into a square grid of world space clusters on the camera's floor, and on
+// the CPU each light is listed in every cluster its radius reaches. The
+// fragment shader looks up its own cluster and evaluates only the lights
+// listed there, so the cost per pixel is bounded by 'max cluster lights'
+// however many lights the map holds.
+//
+// Lights, cluster counts and cluster light lists travel as float textures
+// so the shaders stay within GLSL 1.20. They are double buffered: assign()
+// fills the set the draw thread is not reading and then makes it current,
+// so the lighting state can stay static and draw keeps overlapping the next
+// frame's update and cull.
+class ClusteredLighting : public osg::Referenced
+{
+  struct ClusterBuffer
+  {
+    osg::ref_ptr<osg::Image> light_image;
+    osg::ref_ptr<osg::Image> count_image;
+    osg::ref_ptr<osg::Image> index_image;
+    osg::ref_ptr<osg::Uniform> origin_uniform;
+    osg::ref_ptr<osg::StateSet> state_set;
+  };
+
+  void setup_buffer(ClusterBuffer& buffer);
+  void assign();
+
+  std::vector<PointLight> lights;
+
+  const int grid_size;
+  const int max_cluster_lights;
+  const float cluster_extent;
+
+  int origin_x, origin_y, origin_floor;
+
+  osg::ref_ptr<osg::Program> program;
+
+  std::array<ClusterBuffer, 2> buffers;
+  int current;
+
+public:
+  ClusteredLighting(const MapSystem& map_system);
+
+  // The program, textures on units 1 to 3 and uniforms of the current
+  // buffer, pushed below the scene root by LightingCallback
+  osg::StateSet* get_state_set() const { return buffers[current].state_set.get(); }
+
+  // Reassigns lights when the camera has moved into another cluster; called
+  // during cull by LightingCallback
+  void update(const osg::Vec3& eye);
+
+  size_t get_num_lights() const { return lights.size(); }
+};
+
+}
+
+#endif /* CLUSTEREDLIGHTING_H */
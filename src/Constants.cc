@@ -5,7 +5,11 @@
 const YAML::Node constants = YAML::LoadFile("scripts/constants.yml");
 
 // World
-const auto SEED = constants["seed"].as<unsigned long long>();
+const unsigned long long SEED = constants["seed"].as<unsigned long long>();
+
+// Headless
+const bool HEADLESS = constants["headless"].as<bool>();
+const unsigned long long HEADLESS_TICKS = constants["headless ticks"].as<unsigned long long>();
 
 // Camera
 const double FOV = constants["fov"].as<double>();
@@ -15,13 +19,66 @@ const double CAMERA_HEIGHT = constants["camera height"].as<double>();
 const double CAMERA_OFFSET = constants["camera offset"].as<double>();
 
 // Rendering
+const std::string VIEWER_THREADING = constants["viewer threading"].as<std::string>();
 const int FULLSCREEN_SIZE_X = constants["fullscreen size x"].as<int>();
 const int FULLSCREEN_SIZE_Y = constants["fullscreen size y"].as<int>();
 const double ASPECT_RATIO = (double)FULLSCREEN_SIZE_X / (double)FULLSCREEN_SIZE_Y;
 const double FIXED_TIMESTEP = constants["fixed timestep"].as<double>();
+const bool PORTAL_CULLING = constants["portal culling"].as<bool>();
+
+// Lighting
+const bool SHADER_LIGHTING = constants["shader lighting"].as<bool>();
+const int CLUSTER_SIZE = constants["cluster size"].as<int>();
+const int CLUSTER_GRID_SIZE = constants["cluster grid size"].as<int>();
+const int MAX_CLUSTER_LIGHTS = constants["max cluster lights"].as<int>();
+
+// Assets
+const std::string ASSET_PACK = constants["asset pack"].as<std::string>();
+
+// Paging
+const double CHUNK_EXPIRY_TIME = constants["chunk expiry time"].as<double>();
+const int PAGER_THREADS = constants["pager threads"].as<int>();
 
 // Physics
 const double USER_RADIUS = constants["user radius"].as<double>();
 const double USER_SPEED = constants["user speed"].as<double>();
 const double USER_X_ROT_SPEED = constants["user x rot speed"].as<double>();
 const double USER_Y_ROT_SPEED = constants["user y rot speed"].as<double>();
+
+// Timing
+const double TARGET_FRAME_RATE = constants["target frame rate"].as<double>();
+const double IDLE_FRAME_RATE = constants["idle frame rate"].as<double>();
+const double IDLE_TIMEOUT = constants["idle timeout"].as<double>();
+const double SPIN_THRESHOLD = constants["spin threshold"].as<double>();
+const double HITCH_THRESHOLD = constants["hitch threshold"].as<double>();
+const double STATS_WINDOW = constants["stats window"].as<double>();
+
+// Profiling
+const bool PROFILER_ENABLED = constants["profiler enabled"].as<bool>();
+const std::string PROFILER_OUTPUT = constants["profiler output"].as<std::string>();
+
+// Logging
+const std::string LOG_LEVEL = constants["log level"].as<std::string>();
+const std::string LOG_CONSOLE_LEVEL = constants["log console level"].as<std::string>();
+const std::string LOG_OUTPUT = constants["log output"].as<std::string>();
+const double LOG_FLUSH_INTERVAL = constants["log flush interval"].as<double>();
+
+// Counters
+const std::string COUNTERS_NAME = constants["counters name"].as<std::string>();
+
+// Memory
+const bool MEMORY_DEBUG = constants["memory debug"].as<bool>();
+
+// Jobs
+const int JOB_THREADS = constants["job threads"].as<int>();
+
+// Agents
+const int AGENT_COUNT = constants["agent count"].as<int>();
+const int AGENT_BATCH_SIZE = constants["agent batch size"].as<int>();
+const double AGENT_RADIUS = constants["agent radius"].as<double>();
+const double AGENT_SPEED = constants["agent speed"].as<double>();
+const double AGENT_SEPARATION_RADIUS = constants["agent separation radius"].as<double>();
+const double AGENT_WANDER_JITTER = constants["agent wander jitter"].as<double>();
+const double AGENT_WANDER_WEIGHT = constants["agent wander weight"].as<double>();
+const double AGENT_SEEK_WEIGHT = constants["agent seek weight"].as<double>();
+const double AGENT_SEPARATION_WEIGHT = constants["agent separation weight"].as<double>();
@@ -1,9 +1,15 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <string>
+
 // World
 extern const unsigned long long SEED;
 
+// Headless
+extern const bool HEADLESS;
+extern const unsigned long long HEADLESS_TICKS;
+
 // Camera
 extern const double FOV;
 extern const double NEAR_CLIP;
@@ -12,10 +18,25 @@ extern const double CAMERA_HEIGHT;
 extern const double CAMERA_OFFSET;
 
 // Rendering
+extern const std::string VIEWER_THREADING;
 extern const int FULLSCREEN_SIZE_X;
 extern const int FULLSCREEN_SIZE_Y;
 extern const double ASPECT_RATIO;
 extern const double FIXED_TIMESTEP;
+extern const bool PORTAL_CULLING;
+
+// Lighting
+extern const bool SHADER_LIGHTING;
+extern const int CLUSTER_SIZE;
+extern const int CLUSTER_GRID_SIZE;
+extern const int MAX_CLUSTER_LIGHTS;
+
+// Assets
+extern const std::string ASSET_PACK;
+
+// Paging
+extern const double CHUNK_EXPIRY_TIME;
+extern const int PAGER_THREADS;
 
 // Physics
 extern const double USER_RADIUS;
@@ -23,4 +44,42 @@ extern const double USER_SPEED;
 extern const double USER_X_ROT_SPEED;
 extern const double USER_Y_ROT_SPEED;
 
+// Timing
+extern const double TARGET_FRAME_RATE;
+extern const double IDLE_FRAME_RATE;
+extern const double IDLE_TIMEOUT;
+extern const double SPIN_THRESHOLD;
+extern const double HITCH_THRESHOLD;
+extern const double STATS_WINDOW;
+
+// Profiling
+extern const bool PROFILER_ENABLED;
+extern const std::string PROFILER_OUTPUT;
+
+// Logging
+extern const std::string LOG_LEVEL;
+extern const std::string LOG_CONSOLE_LEVEL;
+extern const std::string LOG_OUTPUT;
+extern const double LOG_FLUSH_INTERVAL;
+
+// Counters
+extern const std::string COUNTERS_NAME;
+
+// Memory
+extern const bool MEMORY_DEBUG;
+
+// Jobs
+extern const int JOB_THREADS;
+
+// Agents
+extern const int AGENT_COUNT;
+extern const int AGENT_BATCH_SIZE;
+extern const double AGENT_RADIUS;
+extern const double AGENT_SPEED;
+extern const double AGENT_SEPARATION_RADIUS;
+extern const double AGENT_WANDER_JITTER;
+extern const double AGENT_WANDER_WEIGHT;
+extern const double AGENT_SEEK_WEIGHT;
+extern const double AGENT_SEPARATION_WEIGHT;
+
 #endif /* CONSTANTS_H */
@@ -0,0 +1,189 @@
+#include "Counters.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace ld;
+using namespace std;
+
+static const char COUNTERS_MAGIC[8] = {'L', 'D', 'C', 'N', 'T', 'R', 'S', '\0'};
+
+static const char* COUNTER_NAMES[NUM_COUNTERS] =
+{
+  "physics.tiles_probed",
+  "physics.collisions_resolved",
+  "map.room_clear_calls",
+  "map.regions_scanned",
+  "render.nodes_built",
+  "time.ticks",
+  "time.tick_time_us",
+  "time.frame_time_us",
+  "time.last_frame_us",
+  "time.hitches",
+  "render.frames"
+};
+
+static const CounterKind COUNTER_KINDS[NUM_COUNTERS] =
+{
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_GAUGE,
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_COUNTER
+};
+
+static constexpr size_t NAMES_OFFSET = sizeof(CounterHeader);
+static constexpr size_t KINDS_OFFSET = NAMES_OFFSET + NUM_COUNTERS * COUNTER_NAME_SIZE;
+
+static size_t header_size()
+{
+  return (KINDS_OFFSET + NUM_COUNTERS + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+thread_local CounterSlot* Counters::local_slot = nullptr;
+
+Counters::Counters()
+  : name(),
+    size(0),
+    segment(nullptr),
+    header(nullptr),
+    slots(nullptr),
+    local_slots(),
+    local_used_slots(0),
+    slots_mutex()
+{}
+
+
+Counters::~Counters()
+{
+  close();
+}
+
+
+const char* Counters::get_name(Counter counter)
+{
+  return COUNTER_NAMES[counter];
+}
+
+
+CounterKind Counters::get_kind(Counter counter)
+{
+  return COUNTER_KINDS[counter];
+}
+
+
+bool Counters::open(const string& name_)
+{
+  lock_guard<mutex> lock(slots_mutex);
+
+  if (segment || name_.empty()) return false;
+
+  auto fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+
+  if (fd < 0)
+  {
+    printf("Counters: could not open shared memory %s\n", name_.c_str());
+    return false;
+  }
+
+  size = header_size() + MAX_COUNTER_SLOTS * sizeof(CounterSlot);
+
+  // Truncating to zero first clears anything left by a previous run
+  auto mapped =
+    ftruncate(fd, 0) == 0 &&
+    ftruncate(fd, size) == 0 &&
+    (segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) != MAP_FAILED;
+
+  ::close(fd);
+
+  if (!mapped)
+  {
+    printf("Counters: could not map shared memory %s\n", name_.c_str());
+
+    shm_unlink(name_.c_str());
+    segment = nullptr;
+
+    return false;
+  }
+
+  name = name_;
+  header = static_cast<CounterHeader*>(segment);
+  slots = reinterpret_cast<CounterSlot*>(static_cast<char*>(segment) + header_size());
+
+  header->version = COUNTERS_VERSION;
+  header->header_size = header_size();
+  header->slot_size = sizeof(CounterSlot);
+  header->num_counters = NUM_COUNTERS;
+  header->num_slots = MAX_COUNTER_SLOTS;
+  header->used_slots = 0;
+  header->pid = getpid();
+  header->names_offset = NAMES_OFFSET;
+  header->kinds_offset = KINDS_OFFSET;
+
+  auto names = static_cast<char*>(segment) + NAMES_OFFSET;
+  auto kinds = reinterpret_cast<uint8_t*>(segment) + KINDS_OFFSET;
+
+  for (auto i = 0; i < NUM_COUNTERS; ++i)
+  {
+    strncpy(names + i * COUNTER_NAME_SIZE, COUNTER_NAMES[i], COUNTER_NAME_SIZE - 1);
+    kinds[i] = COUNTER_KINDS[i];
+  }
+
+  // Readers treat the segment as valid once the magic appears
+  atomic_thread_fence(memory_order_release);
+  memcpy(header->magic, COUNTERS_MAGIC, sizeof(COUNTERS_MAGIC));
+
+  printf("Counters: exporting %s\n", name.c_str());
+
+  return true;
+}
+
+
+void Counters::close()
+{
+  lock_guard<mutex> lock(slots_mutex);
+
+  if (!segment) return;
+
+  // Threads may still hold slot pointers; keep the mapping alive and only
+  // remove the name so readers see the process has gone
+  shm_unlink(name.c_str());
+  memset(header->magic, 0, sizeof(header->magic));
+}
+
+
+CounterSlot* Counters::assign_slot()
+{
+  lock_guard<mutex> lock(slots_mutex);
+
+  if (header)
+  {
+    auto index = header->used_slots.load(memory_order_relaxed);
+
+    // Threads beyond the last slot share it; counters are atomic so the
+    // totals stay correct, only the padding benefit is lost
+    if (index < MAX_COUNTER_SLOTS)
+      header->used_slots.store(index + 1, memory_order_release);
+    else
+      index = MAX_COUNTER_SLOTS - 1;
+
+    local_slot = &slots[index];
+  }
+  else
+  {
+    auto index = local_used_slots < MAX_COUNTER_SLOTS ? local_used_slots++ : MAX_COUNTER_SLOTS - 1;
+
+    local_slot = &local_slots[index];
+  }
+
+  return local_slot;
+}
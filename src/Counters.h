@@ -0,0 +1,122 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace ld
+{
+
+// Live counters shared with external tools through a POSIX shared memory
+// segment. The segment starts with a CounterHeader describing the schema,
+// then the counter name and kind tables at the offsets it records, followed
+// by one cache line aligned CounterSlot per thread. Readers sum a
+// counter across all used slots; a gauge is only ever set by one thread,
+// so the same sum gives its value.
+static constexpr uint32_t COUNTERS_VERSION = 2;
+static constexpr size_t COUNTER_NAME_SIZE = 32;
+static constexpr size_t MAX_COUNTER_SLOTS = 64;
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+enum Counter
+{
+  COUNTER_TILES_PROBED,
+  COUNTER_COLLISIONS_RESOLVED,
+  COUNTER_ROOM_CLEAR_CALLS,
+  COUNTER_REGIONS_SCANNED,
+  COUNTER_NODES_BUILT,
+  COUNTER_TICKS,
+  COUNTER_TICK_TIME_US,
+  COUNTER_FRAME_TIME_US,
+  COUNTER_LAST_FRAME_US,
+  COUNTER_HITCHES,
+  COUNTER_RENDER_FRAMES,
+  NUM_COUNTERS
+};
+
+enum CounterKind
+{
+  COUNTER_KIND_COUNTER,
+  COUNTER_KIND_GAUGE
+};
+
+struct CounterHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t slot_size;
+  uint32_t num_counters;
+  uint32_t num_slots;
+  std::atomic<uint32_t> used_slots;
+  uint64_t pid;
+  uint32_t names_offset;
+  uint32_t kinds_offset;
+};
+
+struct alignas(CACHE_LINE_SIZE) CounterSlot
+{
+  std::atomic<uint64_t> values[NUM_COUNTERS];
+};
+
+class Counters
+{
+  CounterSlot* assign_slot();
+
+  static thread_local CounterSlot* local_slot;
+
+  std::string name;
+  size_t size;
+  void* segment;
+
+  CounterHeader* header;
+  CounterSlot* slots;
+
+  // Used when the segment could not be created, so callers never branch
+  CounterSlot local_slots[MAX_COUNTER_SLOTS];
+  uint32_t local_used_slots;
+
+  std::mutex slots_mutex;
+
+  Counters();
+  ~Counters();
+
+  Counters(const Counters&) = delete;
+  void operator=(const Counters&) = delete;
+
+public:
+  static Counters& instance()
+  {
+    static Counters instance;
+
+    return instance;
+  }
+
+  static const char* get_name(Counter counter);
+  static CounterKind get_kind(Counter counter);
+
+  // Must run before any thread touches a counter: slots are bound to a
+  // thread on first use
+  bool open(const std::string& name);
+  void close();
+
+  static void add(Counter counter, uint64_t value = 1)
+  {
+    auto slot = local_slot ? local_slot : instance().assign_slot();
+
+    slot->values[counter].fetch_add(value, std::memory_order_relaxed);
+  }
+
+  static void set(Counter counter, uint64_t value)
+  {
+    auto slot = local_slot ? local_slot : instance().assign_slot();
+
+    slot->values[counter].store(value, std::memory_order_relaxed);
+  }
+};
+
+}
+
+#endif /* COUNTERS_H */
@@ -0,0 +1,132 @@
+#include "GeometryMerger.h"
+
+#include <osg/Geode>
+#include <osg/NodeVisitor>
+#include <osg/TriangleIndexFunctor>
+
+using namespace ld;
+using namespace osg;
+
+struct TriangleCollector
+{
+  DrawElementsUInt* indices;
+  unsigned base;
+
+  void operator()(unsigned i1, unsigned i2, unsigned i3)
+  {
+    indices->push_back(base + i1);
+    indices->push_back(base + i2);
+    indices->push_back(base + i3);
+  }
+};
+
+
+// Appends every Geometry below a node to the merged arrays, flattening
+// the transforms above it and the placement matrix into the vertices
+class MergeVisitor : public NodeVisitor
+{
+  Vec3Array& vertices;
+  Vec3Array& normals;
+  Vec2Array& tex_coords;
+  DrawElementsUInt& indices;
+
+  const Matrix& placement;
+  const Vec2& offset;
+  const Vec2& scale;
+
+  void append(const Geometry& geometry, const Matrix& matrix)
+  {
+    auto source_vertices = dynamic_cast<const Vec3Array*>(geometry.getVertexArray());
+    auto source_normals = dynamic_cast<const Vec3Array*>(geometry.getNormalArray());
+    auto source_tex_coords = dynamic_cast<const Vec2Array*>(geometry.getTexCoordArray(0));
+
+    if (!source_vertices) return;
+
+    auto inverse = Matrix::inverse(matrix);
+    auto count = source_vertices->size();
+
+    auto per_vertex_normals = source_normals && source_normals->size() == count;
+    auto overall_normal =
+      source_normals && !source_normals->empty() ? (*source_normals)[0] : Vec3(0, 0, 1);
+
+    TriangleIndexFunctor<TriangleCollector> collector;
+    collector.indices = &indices;
+    collector.base = vertices.size();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      auto normal = Matrix::transform3x3(
+	inverse, per_vertex_normals ? (*source_normals)[i] : overall_normal);
+      normal.normalize();
+
+      auto tex_coord =
+	source_tex_coords && i < source_tex_coords->size() ? (*source_tex_coords)[i] : Vec2();
+
+      vertices.push_back((*source_vertices)[i] * matrix);
+      normals.push_back(normal);
+      tex_coords.push_back(
+	Vec2(offset.x() + tex_coord.x() * scale.x(), offset.y() + tex_coord.y() * scale.y()));
+    }
+
+    geometry.accept(collector);
+  }
+
+public:
+  MergeVisitor(
+    Vec3Array& vertices_, Vec3Array& normals_, Vec2Array& tex_coords_,
+    DrawElementsUInt& indices_,
+    const Matrix& placement_, const Vec2& offset_, const Vec2& scale_)
+    : NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN),
+      vertices(vertices_),
+      normals(normals_),
+      tex_coords(tex_coords_),
+      indices(indices_),
+      placement(placement_),
+      offset(offset_),
+      scale(scale_)
+  {}
+
+  virtual void apply(Geode& geode)
+  {
+    auto matrix = computeLocalToWorld(getNodePath()) * placement;
+
+    for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
+    {
+      auto geometry = geode.getDrawable(i)->asGeometry();
+
+      if (geometry) append(*geometry, matrix);
+    }
+  }
+};
+
+
+GeometryMerger::GeometryMerger()
+  : vertices(new Vec3Array),
+    normals(new Vec3Array),
+    tex_coords(new Vec2Array),
+    indices(new DrawElementsUInt(PrimitiveSet::TRIANGLES))
+{}
+
+
+void GeometryMerger::add(
+  Node* model, const Matrix& matrix, const Vec2& offset, const Vec2& scale)
+{
+  if (!model) return;
+
+  MergeVisitor visitor(*vertices, *normals, *tex_coords, *indices, matrix, offset, scale);
+  model->accept(visitor);
+}
+
+
+ref_ptr<Geometry> GeometryMerger::get_geometry() const
+{
+  ref_ptr<Geometry> geometry = new Geometry;
+  geometry->setUseDisplayList(false);
+  geometry->setUseVertexBufferObjects(true);
+  geometry->setVertexArray(vertices);
+  geometry->setNormalArray(normals, Array::BIND_PER_VERTEX);
+  geometry->setTexCoordArray(0, tex_coords, Array::BIND_PER_VERTEX);
+  geometry->addPrimitiveSet(indices);
+
+  return geometry;
+}
@@ -0,0 +1,41 @@
+#ifndef GEOMETRYMERGER_H
+#define GEOMETRYMERGER_H
+
+#include <osg/Geometry>
+#include <osg/Matrix>
+#include <osg/Node>
+#include <osg/Vec2>
+
+namespace ld
+{
+
+// Collects transformed copies of the geometry below shared model nodes
+// into new arrays: vertices, normals and the first set of texture
+// coordinates, with all primitives as one indexed triangle list. The
+// models are only read, so cached nodes can be merged from any thread
+// while others read them too.
+class GeometryMerger
+{
+  osg::ref_ptr<osg::Vec3Array> vertices;
+  osg::ref_ptr<osg::Vec3Array> normals;
+  osg::ref_ptr<osg::Vec2Array> tex_coords;
+  osg::ref_ptr<osg::DrawElementsUInt> indices;
+
+public:
+  GeometryMerger();
+
+  // Texture coordinates are scaled and then offset, to move them into a
+  // region of an atlas
+  void add(
+    osg::Node* model, const osg::Matrix& matrix = osg::Matrix(),
+    const osg::Vec2& offset = osg::Vec2(0.f, 0.f),
+    const osg::Vec2& scale = osg::Vec2(1.f, 1.f));
+
+  bool empty() const { return indices->empty(); }
+
+  osg::ref_ptr<osg::Geometry> get_geometry() const;
+};
+
+}
+
+#endif /* GEOMETRYMERGER_H */
@@ -0,0 +1,80 @@
+#include "Histogram.h"
+
+#include <algorithm>
+
+using namespace ld;
+
+static constexpr int SUB_BUCKET_BITS = 7;
+static constexpr uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+static constexpr size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF;
+
+Histogram::Histogram()
+  : buckets(NUM_BUCKETS, 0),
+    count(0),
+    max(0),
+    sum(0.0)
+{}
+
+
+size_t Histogram::bucket_index(uint64_t value)
+{
+  if (value < SUB_BUCKET_COUNT) return value;
+
+  auto msb = 63 - __builtin_clzll(value);
+  auto shift = msb - (SUB_BUCKET_BITS - 1);
+
+  return shift * SUB_BUCKET_HALF + (value >> shift);
+}
+
+
+uint64_t Histogram::bucket_value(size_t index)
+{
+  if (index < SUB_BUCKET_COUNT) return index;
+
+  auto shift = index / SUB_BUCKET_HALF - 1;
+  auto mantissa = index - shift * SUB_BUCKET_HALF;
+
+  return mantissa << shift;
+}
+
+
+void Histogram::record(uint64_t value)
+{
+  ++buckets[bucket_index(value)];
+  ++count;
+  sum += value;
+  max = std::max(max, value);
+}
+
+
+void Histogram::clear()
+{
+  std::fill(buckets.begin(), buckets.end(), 0);
+
+  count = 0;
+  max = 0;
+  sum = 0.0;
+}
+
+
+uint64_t Histogram::percentile(double p) const
+{
+  if (count == 0) return 0;
+  if (p >= 100.0) return max;
+
+  auto target = (uint64_t)(p / 100.0 * count + 0.5);
+
+  if (target < 1) target = 1;
+
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < buckets.size(); ++i)
+  {
+    seen += buckets[i];
+
+    if (seen >= target) return std::min(bucket_value(i), max);
+  }
+
+  return max;
+}
@@ -0,0 +1,39 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ld
+{
+
+// Log-linear histogram: every power of two is split into 64 linear buckets,
+// so any recorded value is reported to within about 1.6% of its true value.
+class Histogram
+{
+  static size_t bucket_index(uint64_t value);
+  static uint64_t bucket_value(size_t index);
+
+  std::vector<uint64_t> buckets;
+
+  uint64_t count;
+  uint64_t max;
+  double sum;
+
+public:
+  Histogram();
+
+  void record(uint64_t value);
+  void clear();
+
+  uint64_t percentile(double p) const;
+
+  uint64_t get_count() const { return count; }
+  uint64_t get_max() const { return max; }
+  double get_mean() const { return count > 0 ? sum / count : 0.0; }
+};
+
+}
+
+#endif /* HISTOGRAM_H */
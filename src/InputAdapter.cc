@@ -1,7 +1,9 @@
 #include "InputAdapter.h"
 
 #include <iostream>
-#include "systems/MapSystem.h"
+#include "Constants.h"
+#include "Profiler.h"
+#include "systems/CameraSystem.h"
 
 using namespace ld;
 using namespace osg;
@@ -10,6 +12,20 @@ using namespace osg;
 bool InputAdapter::handle(
   const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa)
 {
+  std::lock_guard<std::mutex> lock(input_mutex);
+
+  switch(ea.getEventType())
+  {
+  case osgGA::GUIEventAdapter::PUSH:
+  case osgGA::GUIEventAdapter::MOVE:
+  case osgGA::GUIEventAdapter::KEYDOWN:
+  case osgGA::GUIEventAdapter::KEYUP:
+    input.activity = true;
+    break;
+  default:
+    break;
+  }
+
   switch(ea.getEventType())
   {
   case osgGA::GUIEventAdapter::PUSH:
@@ -74,26 +90,24 @@ bool InputAdapter::handle_key_down(
     input.right = true; return false;
   case 'f':
     input.use = true; return false;
-  case 'e':
+  case 'p':
   {
-    auto& user = entity_system.get_user("kadijah");
+    auto& profiler = Profiler::instance();
 
-    user.inactive_time = 1.0;
-    user.start = user.position;
-    user.target = user.start + Vec3(0, 0, 1);
+    if (profiler.is_enabled())
+    {
+      profiler.set_enabled(false);
+      profiler.dump(PROFILER_OUTPUT);
+    }
+    else
+      profiler.set_enabled(true);
 
     return false;
   }
+  case 'e':
+    input.up = true; return false;
   case 'q':
-  {
-    auto& user = entity_system.get_user("kadijah");
-
-    user.inactive_time = 1.0;
-    user.start = user.position;
-    user.target = user.start - Vec3(0, 0, 1);
-
-    return false;
-  }
+    input.down = true; return false;
   default:
     return false;
   }
@@ -129,14 +143,8 @@ bool InputAdapter::handle_mouse_delta(
 
   center_mouse(ea, aa);
 
-  auto& user = entity_system.get_user("kadijah");
-  user.heading -= user.x_rot_speed * dx;
-  user.pitch -= user.y_rot_speed * dy;
-
-  const double max_pitch = inDegrees(89.f);
-
-  if (user.pitch > max_pitch) user.pitch = max_pitch;
-  else if (user.pitch < -max_pitch) user.pitch = -max_pitch;
+  input.mouse_dx += dx;
+  input.mouse_dy += dy;
 
   return false;
 }
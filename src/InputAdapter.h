@@ -1,14 +1,15 @@
 #ifndef INPUTADAPTER_H
 #define INPUTADAPTER_H
 
+#include <mutex>
 #include <osgGA/GUIEventHandler>
 #include "components/Input.h"
-#include "systems/EntitySystem.h"
-#include "systems/CameraSystem.h"
 
 namespace ld
 {
 
+class CameraSystem;
+
 class InputAdapter : public osgGA::GUIEventHandler
 {
   bool handle_mouse_move(
@@ -26,7 +27,7 @@ class InputAdapter : public osgGA::GUIEventHandler
     const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
 
   Input& input;
-  EntitySystem& entity_system;
+  std::mutex& input_mutex;
   CameraSystem& camera_system;
 
   osg::Vec2 mouse_center;
@@ -34,11 +35,11 @@ class InputAdapter : public osgGA::GUIEventHandler
 public:
   InputAdapter(
     Input& input_,
-    EntitySystem& entity_system_,
+    std::mutex& input_mutex_,
     CameraSystem& camera_system_
   )
     : input(input_),
-      entity_system(entity_system_),
+      input_mutex(input_mutex_),
       camera_system(camera_system_)
   {}
 
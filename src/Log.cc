@@ -0,0 +1,227 @@
+#include "Log.h"
+
+#include "Constants.h"
+
+using namespace ld;
+using namespace std;
+
+static const char LOG_MAGIC[4] = {'L', 'D', 'L', 'G'};
+
+thread_local Logger::Buffer* Logger::local_buffer = nullptr;
+
+Logger::Logger()
+  : level(parse_level(LOG_LEVEL)),
+    console_level(parse_level(LOG_CONSOLE_LEVEL)),
+    file(nullptr),
+    written_sites(),
+    running(false),
+    drain_mutex(),
+    drain_cv(),
+    drain_thread(),
+    buffers_mutex(),
+    buffers()
+{}
+
+
+Logger::Buffer& Logger::get_buffer()
+{
+  if (!local_buffer)
+  {
+    lock_guard<mutex> lock(buffers_mutex);
+
+    buffers.emplace_back(new Buffer(buffers.size()));
+    local_buffer = buffers.back().get();
+  }
+
+  return *local_buffer;
+}
+
+
+char* Logger::reserve(Buffer& buffer, size_t size)
+{
+  auto head = buffer.head.load(memory_order_relaxed);
+  auto tail = buffer.tail.load(memory_order_acquire);
+  auto offset = head % LOG_BUFFER_SIZE;
+
+  // Records never straddle the end of the ring: pad to the start instead
+  auto padding = offset + size > LOG_BUFFER_SIZE ? LOG_BUFFER_SIZE - offset : 0;
+
+  if (head + padding + size - tail > LOG_BUFFER_SIZE)
+  {
+    buffer.dropped.fetch_add(1, memory_order_relaxed);
+    return nullptr;
+  }
+
+  if (padding > 0)
+  {
+    uint32_t marker = 0;
+    memcpy(buffer.data + offset, &marker, sizeof(marker));
+
+    buffer.head.store(head + padding, memory_order_release);
+    offset = 0;
+  }
+
+  return buffer.data + offset;
+}
+
+
+void Logger::start(const string& filename)
+{
+  if (running) return;
+
+  if (!filename.empty())
+  {
+    file = fopen(filename.c_str(), "wb");
+
+    if (file)
+    {
+      fwrite(LOG_MAGIC, sizeof(LOG_MAGIC), 1, file);
+      fwrite(&LOG_VERSION, sizeof(LOG_VERSION), 1, file);
+    }
+    else
+      printf("Logger: could not open %s\n", filename.c_str());
+  }
+
+  running = true;
+
+  drain_thread = thread(
+    [this]()
+    {
+      const auto interval = chrono::duration<double>(LOG_FLUSH_INTERVAL);
+
+      while (running)
+      {
+	{
+	  unique_lock<mutex> lock(drain_mutex);
+	  drain_cv.wait_for(lock, interval, [this]() { return !running; });
+	}
+
+	drain();
+      }
+    });
+}
+
+
+void Logger::stop()
+{
+  if (!running) return;
+
+  {
+    lock_guard<mutex> lock(drain_mutex);
+    running = false;
+  }
+
+  drain_cv.notify_one();
+  drain_thread.join();
+
+  drain();
+
+  if (file)
+  {
+    fclose(file);
+    file = nullptr;
+  }
+}
+
+
+void Logger::drain()
+{
+  vector<Buffer*> snapshot;
+
+  {
+    lock_guard<mutex> lock(buffers_mutex);
+
+    for (const auto& buffer : buffers)
+      snapshot.push_back(buffer.get());
+  }
+
+  for (auto buffer : snapshot)
+    drain(*buffer);
+
+  if (file) fflush(file);
+  fflush(stdout);
+}
+
+
+void Logger::drain(Buffer& buffer)
+{
+  auto tail = buffer.tail.load(memory_order_relaxed);
+  auto head = buffer.head.load(memory_order_acquire);
+
+  while (tail < head)
+  {
+    auto offset = tail % LOG_BUFFER_SIZE;
+
+    LogRecord record;
+    memcpy(&record.size, buffer.data + offset, sizeof(record.size));
+
+    if (record.size == 0)
+    {
+      tail += LOG_BUFFER_SIZE - offset;
+      continue;
+    }
+
+    memcpy(&record, buffer.data + offset, sizeof(record));
+
+    emit(record, buffer.data + offset + sizeof(record));
+
+    tail += record.size;
+  }
+
+  buffer.tail.store(tail, memory_order_release);
+
+  auto dropped = buffer.dropped.exchange(0, memory_order_relaxed);
+
+  if (dropped > 0)
+    printf(
+      "Logger: dropped %llu messages on thread %u\n",
+      (unsigned long long)dropped, buffer.thread_id);
+}
+
+
+void Logger::emit(const LogRecord& record, const char* args)
+{
+  const auto& site = *record.site;
+  auto args_size = record.size - sizeof(LogRecord);
+
+  if (file)
+  {
+    uint64_t site_id = (uintptr_t)record.site;
+
+    if (written_sites.insert(record.site).second)
+    {
+      uint8_t level = site.level;
+      int32_t line = site.line;
+      uint32_t file_size = strlen(site.file);
+      uint32_t format_size = strlen(site.format);
+
+      fputc(LOG_ENTRY_SITE, file);
+      fwrite(&site_id, sizeof(site_id), 1, file);
+      fwrite(&level, sizeof(level), 1, file);
+      fwrite(&line, sizeof(line), 1, file);
+      fwrite(&file_size, sizeof(file_size), 1, file);
+      fwrite(site.file, 1, file_size, file);
+      fwrite(&format_size, sizeof(format_size), 1, file);
+      fwrite(site.format, 1, format_size, file);
+    }
+
+    uint32_t size = args_size;
+
+    fputc(LOG_ENTRY_MESSAGE, file);
+    fwrite(&record.timestamp, sizeof(record.timestamp), 1, file);
+    fwrite(&record.thread_id, sizeof(record.thread_id), 1, file);
+    fwrite(&site_id, sizeof(site_id), 1, file);
+    fwrite(&size, sizeof(size), 1, file);
+    fwrite(args, 1, size, file);
+  }
+
+  if (site.level >= console_level)
+  {
+    auto text = format(site.format, args, args_size);
+
+    if (site.level >= LOG_LEVEL_WARNING)
+      printf("%s: %s", get_level_name(site.level), text.c_str());
+    else
+      fputs(text.c_str(), stdout);
+  }
+}
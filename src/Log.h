@@ -0,0 +1,276 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+// Messages below LOG_MIN_LEVEL are compiled out entirely
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// The format string must be a literal: it is stored once in a static site
+// and only its address is written per message. The dead printf call lets
+// the compiler check the arguments against the format.
+#define LOG_AT(level, format, ...) \
+  do \
+  { \
+    if ((level) >= LOG_MIN_LEVEL && ld::Logger::instance().accepts(level)) \
+    { \
+      static const ld::LogSite log_site = {level, format, __FILE__, __LINE__}; \
+      if (false) printf(format, ##__VA_ARGS__); \
+      ld::Logger::instance().write(log_site, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+#define LOG_DEBUG(format, ...) LOG_AT(ld::LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_AT(ld::LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG_WARNING(format, ...) LOG_AT(ld::LOG_LEVEL_WARNING, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) LOG_AT(ld::LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+
+namespace ld
+{
+
+static constexpr size_t LOG_BUFFER_SIZE = 1 << 16;
+static constexpr uint32_t LOG_VERSION = 1;
+
+enum LogLevel
+{
+  LOG_LEVEL_DEBUG,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_WARNING,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_NONE
+};
+
+enum LogArgType
+{
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_STRING,
+  LOG_ARG_POINTER
+};
+
+// Log files start with a header (magic, version) followed by entries. A
+// SITE entry describes a call site the first time it is used; a MESSAGE
+// entry refers to its site by id and carries the encoded arguments.
+enum LogEntryType
+{
+  LOG_ENTRY_SITE = 'S',
+  LOG_ENTRY_MESSAGE = 'M'
+};
+
+struct LogSite
+{
+  LogLevel level;
+  const char* format;
+  const char* file;
+  int line;
+};
+
+struct LogRecord
+{
+  uint32_t size;
+  uint32_t thread_id;
+  uint64_t timestamp;
+  const LogSite* site;
+};
+
+class Logger
+{
+  // Single producer, single consumer ring of variable sized records. The
+  // owning thread writes at head, the drain thread reads from tail.
+  struct Buffer
+  {
+    Buffer(uint32_t thread_id_) : head(0), tail(0), dropped(0), thread_id(thread_id_) {}
+
+    alignas(8) char data[LOG_BUFFER_SIZE];
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    uint32_t thread_id;
+  };
+
+  Buffer& get_buffer();
+
+  char* reserve(Buffer& buffer, size_t size);
+  void drain();
+  void drain(Buffer& buffer);
+  void emit(const LogRecord& record, const char* args);
+
+  static size_t arg_size() { return 0; }
+
+  template<typename T, typename... Args>
+  static size_t arg_size(const T& arg, const Args&... args)
+  {
+    return encoded_size(arg) + arg_size(args...);
+  }
+
+  static void encode_args(char*) {}
+
+  template<typename T, typename... Args>
+  static void encode_args(char* out, const T& arg, const Args&... args)
+  {
+    encode_args(encode(out, arg), args...);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value, size_t>::type
+  encoded_size(const T&) { return 1 + sizeof(uint64_t); }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+  encoded_size(const T&) { return 1 + sizeof(double); }
+
+  template<typename T>
+  static size_t encoded_size(T* const&) { return 1 + sizeof(uint64_t); }
+
+  static size_t encoded_size(const char* value)
+  {
+    return 1 + sizeof(uint32_t) + strlen(value);
+  }
+
+  static size_t encoded_size(char* value) { return encoded_size((const char*)value); }
+
+  static char* encode_value(char* out, LogArgType type, const void* value, size_t size)
+  {
+    *out++ = type;
+    memcpy(out, value, size);
+
+    return out + size;
+  }
+
+  static char* encode_string(char* out, const char* value, uint32_t size)
+  {
+    out = encode_value(out, LOG_ARG_STRING, &size, sizeof(size));
+    memcpy(out, value, size);
+
+    return out + size;
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value, char*>::type
+  encode(char* out, const T& value)
+  {
+    if (std::is_signed<T>::value)
+    {
+      int64_t v = value;
+      return encode_value(out, LOG_ARG_INT, &v, sizeof(v));
+    }
+    else
+    {
+      uint64_t v = value;
+      return encode_value(out, LOG_ARG_UINT, &v, sizeof(v));
+    }
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, char*>::type
+  encode(char* out, const T& value)
+  {
+    double v = value;
+    return encode_value(out, LOG_ARG_DOUBLE, &v, sizeof(v));
+  }
+
+  template<typename T>
+  static char* encode(char* out, T* const& value)
+  {
+    uint64_t v = (uintptr_t)value;
+    return encode_value(out, LOG_ARG_POINTER, &v, sizeof(v));
+  }
+
+  static char* encode(char* out, const char* value)
+  {
+    return encode_string(out, value, strlen(value));
+  }
+
+  static char* encode(char* out, char* value) { return encode(out, (const char*)value); }
+
+  static thread_local Buffer* local_buffer;
+
+  std::atomic<int> level;
+  int console_level;
+
+  FILE* file;
+  std::unordered_set<const LogSite*> written_sites;
+
+  std::atomic<bool> running;
+  std::mutex drain_mutex;
+  std::condition_variable drain_cv;
+  std::thread drain_thread;
+
+  std::mutex buffers_mutex;
+  std::vector<std::unique_ptr<Buffer>> buffers;
+
+  Logger();
+
+  Logger(const Logger&) = delete;
+  void operator=(const Logger&) = delete;
+
+public:
+  static Logger& instance()
+  {
+    static Logger instance;
+
+    return instance;
+  }
+
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  static LogLevel parse_level(const std::string& name);
+  static const char* get_level_name(int level);
+
+  static std::string format(const char* format, const char* args, size_t size);
+
+  bool accepts(int level_) const
+  {
+    return level_ >= level.load(std::memory_order_relaxed);
+  }
+
+  void set_level(LogLevel level_) { level = level_; }
+
+  void start(const std::string& filename);
+  void stop();
+
+  template<typename... Args>
+  void write(const LogSite& site, const Args&... args)
+  {
+    auto& buffer = get_buffer();
+    auto args_size = arg_size(args...);
+
+    // Keep records 8 byte aligned so the header can be read in place
+    auto size = (sizeof(LogRecord) + args_size + 7) & ~size_t(7);
+
+    auto out = reserve(buffer, size);
+
+    if (!out) return;
+
+    LogRecord record = {(uint32_t)size, buffer.thread_id, now(), &site};
+
+    memcpy(out, &record, sizeof(record));
+    encode_args(out + sizeof(record), args...);
+
+    buffer.head.store(
+      buffer.head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+  }
+};
+
+}
+
+#endif /* LOG_H */
@@ -0,0 +1,143 @@
+#include "Log.h"
+
+using namespace ld;
+using namespace std;
+
+// Kept apart from the Logger itself, which reads its levels from the
+// constants, so LastDitchLogDecoder can be built from this file alone
+static const char* LEVEL_NAMES[] = {"debug", "info", "warning", "error", "none"};
+
+LogLevel Logger::parse_level(const string& name)
+{
+  for (auto i = 0; i <= LOG_LEVEL_NONE; ++i)
+    if (name == LEVEL_NAMES[i]) return (LogLevel)i;
+
+  return LOG_LEVEL_INFO;
+}
+
+
+const char* Logger::get_level_name(int level)
+{
+  return level >= 0 && level <= LOG_LEVEL_NONE ? LEVEL_NAMES[level] : "unknown";
+}
+
+
+string Logger::format(const char* format, const char* args, size_t size)
+{
+  string text;
+  auto end = args + size;
+
+  for (auto c = format; *c; ++c)
+  {
+    if (*c != '%')
+    {
+      text += *c;
+      continue;
+    }
+
+    if (c[1] == '%')
+    {
+      text += '%';
+      ++c;
+      continue;
+    }
+
+    // Keep flags, width and precision, drop length modifiers: arguments
+    // are always stored widened
+    string spec = "%";
+
+    for (++c; *c && strchr("-+ #0123456789.", *c); ++c)
+      spec += *c;
+
+    while (*c && strchr("hlLqjzt", *c))
+      ++c;
+
+    if (!*c) break;
+
+    auto conversion = *c;
+
+    if (args >= end)
+    {
+      text += "<missing>";
+      continue;
+    }
+
+    auto type = (LogArgType)*args++;
+
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0;
+    string s;
+
+    switch (type)
+    {
+    case LOG_ARG_INT:
+      memcpy(&i, args, sizeof(i));
+      args += sizeof(i);
+      u = i;
+      d = i;
+      break;
+    case LOG_ARG_UINT:
+    case LOG_ARG_POINTER:
+      memcpy(&u, args, sizeof(u));
+      args += sizeof(u);
+      i = u;
+      d = u;
+      break;
+    case LOG_ARG_DOUBLE:
+      memcpy(&d, args, sizeof(d));
+      args += sizeof(d);
+      i = d;
+      u = d;
+      break;
+    case LOG_ARG_STRING:
+    {
+      uint32_t length;
+      memcpy(&length, args, sizeof(length));
+      args += sizeof(length);
+      s.assign(args, length);
+      args += length;
+      break;
+    }
+    }
+
+    char buffer[512];
+
+    switch (conversion)
+    {
+    case 'd':
+    case 'i':
+      spec += "lld";
+      snprintf(buffer, sizeof(buffer), spec.c_str(), (long long)i);
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec += "ll";
+      spec += conversion;
+      snprintf(buffer, sizeof(buffer), spec.c_str(), (unsigned long long)u);
+      break;
+    case 'c':
+      spec += 'c';
+      snprintf(buffer, sizeof(buffer), spec.c_str(), (int)i);
+      break;
+    case 'p':
+      spec += 'p';
+      snprintf(buffer, sizeof(buffer), spec.c_str(), (void*)(uintptr_t)u);
+      break;
+    case 's':
+      spec += 's';
+      snprintf(buffer, sizeof(buffer), spec.c_str(), s.c_str());
+      break;
+    default:
+      spec += conversion;
+      snprintf(buffer, sizeof(buffer), spec.c_str(), d);
+      break;
+    }
+
+    text += buffer;
+  }
+
+  return text;
+}
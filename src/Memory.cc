@@ -0,0 +1,363 @@
+#include "Memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <new>
+#include <vector>
+
+using namespace ld;
+using namespace std;
+
+// Kept 16 bytes so the memory handed out keeps malloc's alignment
+struct AllocationHeader
+{
+  uint64_t size;
+  uint32_t tag;
+  uint32_t padding;
+};
+
+struct TagCounters
+{
+  atomic<uint64_t> current_bytes;
+  atomic<uint64_t> peak_bytes;
+  atomic<uint64_t> allocations;
+  atomic<uint64_t> frame_allocations;
+};
+
+struct SiteCounters
+{
+  atomic<uintptr_t> site;
+  atomic<uint64_t> count;
+  atomic<uint64_t> bytes;
+};
+
+struct FrameCounters
+{
+  uint64_t last;
+  uint64_t max;
+  uint64_t total;
+};
+
+static const char* MEMORY_TAG_NAMES[NUM_MEMORY_TAGS] =
+{
+  "general", "map", "entity", "agent", "physics", "render", "jobs"
+};
+
+// Mangled prefixes of operator new and of the std and __gnu_cxx namespaces,
+// whose containers and allocators are instantiated into the executable
+static const char* ALLOCATOR_SYMBOLS[] =
+{
+  "_Znw", "_Zna", "_ZSt", "_ZNSt", "_ZNKSt", "_ZNSa", "_ZNSs", "_ZNKSs", "_ZN9__gnu_cxx"
+};
+
+static TagCounters tag_counters[NUM_MEMORY_TAGS];
+static SiteCounters site_counters[MEMORY_SITE_TABLE_SIZE];
+static FrameCounters frame_counters[NUM_MEMORY_TAGS];
+static uint64_t frames = 0;
+
+static atomic<bool> debug(false);
+
+static thread_local MemoryTag current_tag = MEMORY_GENERAL;
+
+static void record_site(void* site, size_t size)
+{
+  auto key = reinterpret_cast<uintptr_t>(site);
+  auto index = (key >> 4) * 0x9e3779b97f4a7c15ULL;
+
+  // Open addressing with a short probe; sites past a full table are dropped
+  for (size_t probe = 0; probe < 64; ++probe)
+  {
+    auto& entry = site_counters[(index + probe) % MEMORY_SITE_TABLE_SIZE];
+    auto current = entry.site.load(memory_order_relaxed);
+
+    if (current == 0 && entry.site.compare_exchange_strong(current, key))
+      current = key;
+
+    if (current == key)
+    {
+      entry.count.fetch_add(1, memory_order_relaxed);
+      entry.bytes.fetch_add(size, memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+
+static void* get_executable_base()
+{
+  Dl_info info;
+
+  return dladdr(reinterpret_cast<void*>(&get_executable_base), &info) ? info.dli_fbase : nullptr;
+}
+
+
+static bool is_allocator_frame(void* frame)
+{
+  static void* executable = get_executable_base();
+
+  Dl_info info;
+
+  if (!dladdr(frame, &info)) return true;
+
+  // Code in shared libraries, the C++ runtime and OSG among them, is
+  // charged to the game code that called into it
+  if (info.dli_fbase != executable) return true;
+
+  if (!info.dli_sname) return false;
+
+  for (auto prefix : ALLOCATOR_SYMBOLS)
+    if (strncmp(info.dli_sname, prefix, strlen(prefix)) == 0) return true;
+
+  return false;
+}
+
+
+// Only called in debug mode, as walking the stack costs far more than the
+// allocation itself
+static __attribute__((noinline)) void* find_site()
+{
+  void* frames[MEMORY_SITE_DEPTH];
+
+  auto depth = backtrace(frames, MEMORY_SITE_DEPTH);
+
+  // Frame 0 is this function and frame 1 allocate
+  for (auto i = 2; i < depth; ++i)
+    if (!is_allocator_frame(frames[i])) return frames[i];
+
+  // Allocations made entirely inside a library thread are charged to the
+  // caller of operator new
+  return depth > 3 ? frames[3] : nullptr;
+}
+
+
+static __attribute__((noinline)) void* allocate(size_t size)
+{
+  auto header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+
+  if (!header) return nullptr;
+
+  header->size = size;
+  header->tag = current_tag;
+
+  auto site = debug.load(memory_order_relaxed) ? find_site() : nullptr;
+
+  MemoryTracker::allocated(site, current_tag, size);
+
+  return header + 1;
+}
+
+
+static void deallocate(void* pointer)
+{
+  if (!pointer) return;
+
+  auto header = static_cast<AllocationHeader*>(pointer) - 1;
+
+  MemoryTracker::freed((MemoryTag)header->tag, header->size);
+
+  free(header);
+}
+
+
+void* operator new(size_t size)
+{
+  auto pointer = allocate(size);
+
+  if (!pointer) throw bad_alloc();
+
+  return pointer;
+}
+
+
+void* operator new[](size_t size)
+{
+  auto pointer = allocate(size);
+
+  if (!pointer) throw bad_alloc();
+
+  return pointer;
+}
+
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+
+void operator delete(void* pointer) noexcept
+{
+  deallocate(pointer);
+}
+
+
+void operator delete[](void* pointer) noexcept
+{
+  deallocate(pointer);
+}
+
+
+void operator delete(void* pointer, const nothrow_t&) noexcept
+{
+  deallocate(pointer);
+}
+
+
+void operator delete[](void* pointer, const nothrow_t&) noexcept
+{
+  deallocate(pointer);
+}
+
+
+MemoryTag MemoryTracker::get_tag()
+{
+  return current_tag;
+}
+
+
+void MemoryTracker::set_tag(MemoryTag tag)
+{
+  current_tag = tag;
+}
+
+
+void MemoryTracker::allocated(void* site, MemoryTag tag, size_t size)
+{
+  auto& counters = tag_counters[tag];
+
+  auto current = counters.current_bytes.fetch_add(size, memory_order_relaxed) + size;
+  auto peak = counters.peak_bytes.load(memory_order_relaxed);
+
+  while (current > peak &&
+	 !counters.peak_bytes.compare_exchange_weak(peak, current, memory_order_relaxed))
+    ;
+
+  counters.allocations.fetch_add(1, memory_order_relaxed);
+  counters.frame_allocations.fetch_add(1, memory_order_relaxed);
+
+  if (site && debug.load(memory_order_relaxed)) record_site(site, size);
+}
+
+
+void MemoryTracker::freed(MemoryTag tag, size_t size)
+{
+  tag_counters[tag].current_bytes.fetch_sub(size, memory_order_relaxed);
+}
+
+
+void MemoryTracker::set_debug(bool debug_)
+{
+  debug = debug_;
+}
+
+
+bool MemoryTracker::is_debug()
+{
+  return debug;
+}
+
+
+void MemoryTracker::end_frame()
+{
+  for (auto tag = 0; tag < NUM_MEMORY_TAGS; ++tag)
+  {
+    auto count = tag_counters[tag].frame_allocations.exchange(0, memory_order_relaxed);
+    auto& frame = frame_counters[tag];
+
+    frame.last = count;
+    frame.max = std::max(frame.max, count);
+    frame.total += count;
+  }
+
+  ++frames;
+}
+
+
+MemoryStats MemoryTracker::get_stats(MemoryTag tag)
+{
+  const auto& counters = tag_counters[tag];
+  const auto& frame = frame_counters[tag];
+
+  MemoryStats stats;
+
+  stats.current_bytes = counters.current_bytes.load(memory_order_relaxed);
+  stats.peak_bytes = counters.peak_bytes.load(memory_order_relaxed);
+  stats.allocations = counters.allocations.load(memory_order_relaxed);
+  stats.last_frame_allocations = frame.last;
+  stats.max_frame_allocations = frame.max;
+  stats.mean_frame_allocations = frames > 0 ? (double)frame.total / frames : 0.0;
+
+  return stats;
+}
+
+
+const char* MemoryTracker::get_name(MemoryTag tag)
+{
+  return MEMORY_TAG_NAMES[tag];
+}
+
+
+void MemoryTracker::report(size_t num_sites)
+{
+  printf(
+    "%-10s %12s %12s %12s %10s %10s\n",
+    "Memory", "current KB", "peak KB", "allocs", "mean/tick", "max/tick");
+
+  for (auto tag = 0; tag < NUM_MEMORY_TAGS; ++tag)
+  {
+    auto stats = get_stats((MemoryTag)tag);
+
+    printf(
+      "%-10s %12.1f %12.1f %12llu %10.1f %10llu\n",
+      get_name((MemoryTag)tag),
+      stats.current_bytes / 1024.0,
+      stats.peak_bytes / 1024.0,
+      (unsigned long long)stats.allocations,
+      stats.mean_frame_allocations,
+      (unsigned long long)stats.max_frame_allocations);
+  }
+
+  if (!debug) return;
+
+  vector<const SiteCounters*> sites;
+
+  for (const auto& entry : site_counters)
+    if (entry.site.load(memory_order_relaxed) != 0) sites.push_back(&entry);
+
+  sort(
+    sites.begin(), sites.end(),
+    [](const SiteCounters* a, const SiteCounters* b) { return a->count > b->count; });
+
+  if (sites.size() > num_sites) sites.resize(num_sites);
+
+  vector<void*> addresses;
+
+  for (auto entry : sites)
+    addresses.push_back(reinterpret_cast<void*>(entry->site.load()));
+
+  auto symbols = backtrace_symbols(addresses.data(), addresses.size());
+
+  printf("Top allocation sites:\n");
+
+  for (size_t i = 0; i < sites.size(); ++i)
+  {
+    printf(
+      "%10llu allocs %12llu bytes  %s\n",
+      (unsigned long long)sites[i]->count.load(),
+      (unsigned long long)sites[i]->bytes.load(),
+      symbols ? symbols[i] : "?");
+  }
+
+  free(symbols);
+}
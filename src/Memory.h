@@ -0,0 +1,88 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define MEMORY_CONCAT_IMPL(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_IMPL(a, b)
+#define MEMORY_SCOPE(tag) \
+  ld::MemoryScope MEMORY_CONCAT(memory_scope_, __LINE__)(tag)
+
+namespace ld
+{
+
+// Every heap allocation made through operator new is charged to the tag of
+// the innermost MEMORY_SCOPE on the allocating thread
+enum MemoryTag
+{
+  MEMORY_GENERAL,
+  MEMORY_MAP,
+  MEMORY_ENTITY,
+  MEMORY_AGENT,
+  MEMORY_PHYSICS,
+  MEMORY_RENDER,
+  MEMORY_JOBS,
+  NUM_MEMORY_TAGS
+};
+
+static constexpr size_t MEMORY_SITE_TABLE_SIZE = 4096;
+static constexpr int MEMORY_SITE_DEPTH = 16;
+
+struct MemoryStats
+{
+  uint64_t current_bytes;
+  uint64_t peak_bytes;
+  uint64_t allocations;
+  uint64_t last_frame_allocations;
+  uint64_t max_frame_allocations;
+  double mean_frame_allocations;
+};
+
+// The tracker's state is constant initialised so operator new can use it
+// before, and after, any other static initialisation
+class MemoryTracker
+{
+public:
+  static MemoryTag get_tag();
+  static void set_tag(MemoryTag tag);
+
+  static void allocated(void* site, MemoryTag tag, size_t size);
+  static void freed(MemoryTag tag, size_t size);
+
+  // Debug mode walks the stack of every allocation and records counts per
+  // site, the first frame in the game's own code rather than in operator
+  // new, the standard library or a shared library
+  static void set_debug(bool debug);
+  static bool is_debug();
+
+  // Closes the current frame's allocation counts, call once per tick
+  static void end_frame();
+
+  static MemoryStats get_stats(MemoryTag tag);
+  static const char* get_name(MemoryTag tag);
+
+  static void report(size_t num_sites = 20);
+};
+
+
+class MemoryScope
+{
+  MemoryTag previous;
+
+public:
+  MemoryScope(MemoryTag tag)
+    : previous(MemoryTracker::get_tag())
+  {
+    MemoryTracker::set_tag(tag);
+  }
+
+  ~MemoryScope()
+  {
+    MemoryTracker::set_tag(previous);
+  }
+};
+
+}
+
+#endif /* MEMORY_H */
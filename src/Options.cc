@@ -0,0 +1,46 @@
+#include "Options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "Constants.h"
+
+using namespace ld;
+using namespace std;
+
+Options::Options()
+  : headless(HEADLESS),
+    ticks(HEADLESS_TICKS),
+    record_file(),
+    replay_file(),
+    hash_log_file(),
+    hash_verify_file()
+{}
+
+
+Options ld::parse_options(int argc, char** argv)
+{
+  Options options;
+
+  for (auto i = 1; i < argc; ++i)
+  {
+    string arg(argv[i]);
+
+    if (arg == "--headless")
+      options.headless = true;
+    else if (arg == "--ticks" && i + 1 < argc)
+      options.ticks = strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--record" && i + 1 < argc)
+      options.record_file = argv[++i];
+    else if (arg == "--replay" && i + 1 < argc)
+      options.replay_file = argv[++i];
+    else if (arg == "--hash-log" && i + 1 < argc)
+      options.hash_log_file = argv[++i];
+    else if (arg == "--verify-hashes" && i + 1 < argc)
+      options.hash_verify_file = argv[++i];
+    else
+      printf("Ignoring unknown argument '%s'\n", arg.c_str());
+  }
+
+  return options;
+}
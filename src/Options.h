@@ -0,0 +1,27 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+
+namespace ld
+{
+
+struct Options
+{
+  Options();
+
+  bool headless;
+  unsigned long long ticks;
+
+  std::string record_file;
+  std::string replay_file;
+
+  std::string hash_log_file;
+  std::string hash_verify_file;
+};
+
+Options parse_options(int argc, char** argv);
+
+}
+
+#endif /* OPTIONS_H */
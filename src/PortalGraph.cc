@@ -0,0 +1,291 @@
+#include "PortalGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Profiler.h"
+
+using namespace ld;
+using namespace osg;
+
+static const ScreenRect EMPTY_RECT = {1.f, 1.f, -1.f, -1.f};
+static const ScreenRect FULL_RECT = {-1.f, -1.f, 1.f, 1.f};
+
+static bool is_interior(const Room& room, int x, int y)
+{
+  return x > room.x && x < room.x + room.w - 1 && y > room.y && y < room.y + room.h - 1;
+}
+
+
+static bool contains(const Room& room, int x, int y)
+{
+  return x >= room.x && x <= room.x + room.w - 1 && y >= room.y && y <= room.y + room.h - 1;
+}
+
+
+PortalGraph::PortalGraph(const MapSystem& map_system, const EntitySystem& entity_system)
+  : rooms(map_system.get_rooms()),
+    master_rooms(map_system.get_master_rooms()),
+    first_cells(),
+    num_cells(0),
+    portals(),
+    cell_portals(),
+    doors_open(),
+    visible_rects()
+{
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    first_cells[floor] = num_cells;
+    num_cells += rooms[floor].size() + master_rooms[floor].size() + 1;
+  }
+
+  visible_rects.assign(num_cells, FULL_RECT);
+
+  set_doors(entity_system.get_doors());
+}
+
+
+// The single cell a position in open space belongs to
+int PortalGraph::get_cell(int x, int y, int floor) const
+{
+  auto first = first_cells[floor];
+
+  for (size_t i = 0; i < rooms[floor].size(); ++i)
+    if (is_interior(rooms[floor][i], x, y)) return first + i;
+
+  first += rooms[floor].size();
+
+  for (size_t i = 0; i < master_rooms[floor].size(); ++i)
+    if (contains(master_rooms[floor][i], x, y)) return first + i;
+
+  return first + master_rooms[floor].size();
+}
+
+
+// Walls can be seen from every cell they border, so a wall tile belongs to
+// each of them
+CellSet PortalGraph::get_cells(int x, int y, int floor) const
+{
+  CellSet cells;
+
+  auto first = first_cells[floor];
+  auto outside = first + rooms[floor].size() + master_rooms[floor].size();
+
+  for (size_t i = 0; i < rooms[floor].size(); ++i)
+  {
+    const auto& room = rooms[floor][i];
+
+    if (is_interior(room, x, y)) return {first + (int)i};
+
+    if (contains(room, x, y)) cells.push_back(first + i);
+  }
+
+  first += rooms[floor].size();
+
+  auto in_master = false;
+
+  for (size_t i = 0; i < master_rooms[floor].size(); ++i)
+  {
+    const auto& master = master_rooms[floor][i];
+
+    if (!contains(master, x, y)) continue;
+
+    in_master = true;
+    cells.push_back(first + i);
+
+    if (!is_interior(master, x, y)) cells.push_back(outside);
+  }
+
+  if (!in_master) cells.push_back(outside);
+
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  return cells;
+}
+
+
+void PortalGraph::set_doors(const std::array<std::vector<Door>, NUM_FLOORS>& doors)
+{
+  portals.clear();
+  cell_portals.assign(num_cells, std::vector<size_t>());
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    doors_open[floor].assign(doors[floor].size(), false);
+
+    for (size_t i = 0; i < doors[floor].size(); ++i)
+    {
+      const auto& door = doors[floor][i];
+
+      // Doors in walls running along x lead north and south, the rest east
+      // and west
+      auto along_x = (int)std::round(door.rotation) % 180 == 0;
+
+      auto a = along_x ?
+	get_cell(door.x, door.y - 1, floor) : get_cell(door.x - 1, door.y, floor);
+      auto b = along_x ?
+	get_cell(door.x, door.y + 1, floor) : get_cell(door.x + 1, door.y, floor);
+
+      if (a == b) continue;
+
+      Portal portal;
+      portal.floor = floor;
+      portal.door = i;
+      portal.cells[0] = a;
+      portal.cells[1] = b;
+      portal.bounds = BoundingBox(
+	TILE_SIZE * (door.x - .5), TILE_SIZE * (door.y - .5), FLOOR_HEIGHT * floor,
+	TILE_SIZE * (door.x + .5), TILE_SIZE * (door.y + .5), FLOOR_HEIGHT * (floor + 1));
+
+      cell_portals[a].push_back(portals.size());
+      cell_portals[b].push_back(portals.size());
+
+      portals.push_back(portal);
+    }
+  }
+}
+
+
+void PortalGraph::set_door_open(int floor, size_t door, bool open)
+{
+  if (door < doors_open[floor].size()) doors_open[floor][door] = open;
+}
+
+
+void PortalGraph::update(osgUtil::CullVisitor& cull_visitor)
+{
+  PROFILE_SCOPE("PortalGraph::update");
+
+  std::fill(visible_rects.begin(), visible_rects.end(), EMPTY_RECT);
+
+  const auto& eye = cull_visitor.getEyeLocal();
+  auto view_projection =
+    *cull_visitor.getModelViewMatrix() * *cull_visitor.getProjectionMatrix();
+
+  auto x = (int)std::round(eye.x() / TILE_SIZE);
+  auto y = (int)std::round(eye.y() / TILE_SIZE);
+  auto floor = std::min(std::max((int)std::floor(eye.z() / FLOOR_HEIGHT), 0), NUM_FLOORS - 1);
+
+  auto outside_map = std::abs(x) > MAP_SIZE / 2 || std::abs(y) > MAP_SIZE / 2;
+
+  auto cells = outside_map ?
+    CellSet{first_cells[floor] + (int)(rooms[floor].size() + master_rooms[floor].size())} :
+    get_cells(x, y, floor);
+
+  for (auto cell : cells)
+    flood(cell, FULL_RECT, view_projection, 0);
+}
+
+
+void PortalGraph::flood(
+  int cell, const ScreenRect& rect, const Matrix& view_projection, int depth)
+{
+  auto& visible = visible_rects[cell];
+
+  // Revisit a cell only when this path shows more of it than earlier ones
+  if (!visible.empty() &&
+      rect.x_min >= visible.x_min && rect.x_max <= visible.x_max &&
+      rect.y_min >= visible.y_min && rect.y_max <= visible.y_max)
+  {
+    return;
+  }
+
+  if (visible.empty())
+  {
+    visible = rect;
+  }
+  else
+  {
+    visible.x_min = std::min(visible.x_min, rect.x_min);
+    visible.y_min = std::min(visible.y_min, rect.y_min);
+    visible.x_max = std::max(visible.x_max, rect.x_max);
+    visible.y_max = std::max(visible.y_max, rect.y_max);
+  }
+
+  if (depth >= num_cells) return;
+
+  for (auto index : cell_portals[cell])
+  {
+    const auto& portal = portals[index];
+
+    if (!doors_open[portal.floor][portal.door]) continue;
+
+    ScreenRect portal_rect;
+
+    if (!project(portal.bounds, view_projection, portal_rect)) continue;
+
+    ScreenRect next = {
+      std::max(rect.x_min, portal_rect.x_min),
+      std::max(rect.y_min, portal_rect.y_min),
+      std::min(rect.x_max, portal_rect.x_max),
+      std::min(rect.y_max, portal_rect.y_max)};
+
+    if (next.empty()) continue;
+
+    auto other = portal.cells[0] == cell ? portal.cells[1] : portal.cells[0];
+
+    flood(other, next, view_projection, depth + 1);
+  }
+}
+
+
+// Screen rectangle covered by a box, clipped to the viewport. A box the
+// eye plane passes through covers the whole screen as far as this is
+// concerned; one entirely behind the eye covers none of it.
+bool PortalGraph::project(
+  const BoundingBox& bounds, const Matrix& view_projection, ScreenRect& rect) const
+{
+  rect = EMPTY_RECT;
+
+  auto behind = 0;
+
+  for (auto i = 0; i < 8; ++i)
+  {
+    auto clip = Vec4(bounds.corner(i), 1.f) * view_projection;
+
+    if (clip.w() <= 1e-4f)
+    {
+      ++behind;
+      continue;
+    }
+
+    auto x = clip.x() / clip.w();
+    auto y = clip.y() / clip.w();
+
+    if (rect.empty())
+    {
+      rect = {x, y, x, y};
+    }
+    else
+    {
+      rect.x_min = std::min(rect.x_min, x);
+      rect.y_min = std::min(rect.y_min, y);
+      rect.x_max = std::max(rect.x_max, x);
+      rect.y_max = std::max(rect.y_max, y);
+    }
+  }
+
+  if (behind == 8) return false;
+
+  if (behind > 0)
+  {
+    rect = FULL_RECT;
+    return true;
+  }
+
+  rect.x_min = std::max(rect.x_min, -1.f);
+  rect.y_min = std::max(rect.y_min, -1.f);
+  rect.x_max = std::min(rect.x_max, 1.f);
+  rect.y_max = std::min(rect.y_max, 1.f);
+
+  return !rect.empty();
+}
+
+
+bool PortalGraph::is_visible(const CellSet& cells) const
+{
+  for (auto cell : cells)
+    if (!visible_rects[cell].empty()) return true;
+
+  return cells.empty();
+}
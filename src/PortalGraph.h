@@ -0,0 +1,76 @@
+#ifndef PORTALGRAPH_H
+#define PORTALGRAPH_H
+
+#include <array>
+#include <vector>
+#include <osg/BoundingBox>
+#include <osg/Matrix>
+#include <osg/Referenced>
+#include <osgUtil/CullVisitor>
+#include "systems/EntitySystem.h"
+#include "systems/MapSystem.h"
+
+namespace ld
+{
+
+// Ids of the cells a piece of geometry can be seen from, sorted
+typedef std::vector<int> CellSet;
+
+struct Portal
+{
+  int floor;
+  size_t door;
+  int cells[2];
+  osg::BoundingBox bounds;
+};
+
+// Screen space rectangle in normalized device coordinates
+struct ScreenRect
+{
+  float x_min, y_min, x_max, y_max;
+
+  bool empty() const { return x_min > x_max || y_min > y_max; }
+};
+
+// Splits every floor into cells: one per room, one for the rest of each
+// master room, and one for the outside. Doors are the portals between
+// them. Each cull, the cells reachable from the camera's cell through open
+// doors on screen are found, narrowing the visible screen area at every
+// portal, and geometry tagged with none of those cells is skipped.
+class PortalGraph : public osg::Referenced
+{
+  int get_cell(int x, int y, int floor) const;
+
+  void flood(int cell, const ScreenRect& rect, const osg::Matrix& view_projection, int depth);
+  bool project(
+    const osg::BoundingBox& bounds, const osg::Matrix& view_projection, ScreenRect& rect) const;
+
+  std::array<std::vector<Room>, NUM_FLOORS> rooms;
+  std::array<std::vector<Room>, NUM_FLOORS> master_rooms;
+  std::array<int, NUM_FLOORS> first_cells;
+  int num_cells;
+
+  std::vector<Portal> portals;
+  std::vector<std::vector<size_t>> cell_portals;
+  std::array<std::vector<bool>, NUM_FLOORS> doors_open;
+
+  std::vector<ScreenRect> visible_rects;
+
+public:
+  PortalGraph(const MapSystem& map_system, const EntitySystem& entity_system);
+
+  CellSet get_cells(int x, int y, int floor) const;
+
+  // Rebuilds the portals; doors start closed
+  void set_doors(const std::array<std::vector<Door>, NUM_FLOORS>& doors);
+  void set_door_open(int floor, size_t door, bool open);
+
+  // Called once per cull, before any tagged geometry is traversed
+  void update(osgUtil::CullVisitor& cull_visitor);
+
+  bool is_visible(const CellSet& cells) const;
+};
+
+}
+
+#endif /* PORTALGRAPH_H */
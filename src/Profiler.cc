@@ -0,0 +1,99 @@
+#include "Profiler.h"
+
+#include <cstdio>
+#include "Constants.h"
+
+using namespace ld;
+using namespace std;
+
+thread_local Profiler::Buffer* Profiler::local_buffer = nullptr;
+
+Profiler::Profiler()
+  : enabled(PROFILER_ENABLED),
+    buffers_mutex(),
+    buffers()
+{}
+
+
+Profiler::Buffer& Profiler::get_buffer()
+{
+  if (!local_buffer)
+  {
+    lock_guard<mutex> lock(buffers_mutex);
+
+    buffers.emplace_back(new Buffer(buffers.size()));
+    local_buffer = buffers.back().get();
+  }
+
+  return *local_buffer;
+}
+
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end)
+{
+  auto& buffer = get_buffer();
+  auto head = buffer.head.load(memory_order_relaxed);
+
+  buffer.events[head % PROFILE_BUFFER_SIZE] = {name, start, end};
+  buffer.head.store(head + 1, memory_order_release);
+}
+
+
+bool Profiler::dump(const string& filename)
+{
+  auto file = fopen(filename.c_str(), "w");
+
+  if (!file)
+  {
+    printf("Profiler: could not open %s\n", filename.c_str());
+    return false;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  auto first = true;
+  size_t count = 0;
+
+  lock_guard<mutex> lock(buffers_mutex);
+
+  for (const auto& buffer : buffers)
+  {
+    auto head = buffer->head.load(memory_order_acquire);
+    auto begin = head > PROFILE_BUFFER_SIZE ? head - PROFILE_BUFFER_SIZE : 0;
+
+    vector<ProfileEvent> events;
+    events.reserve(head - begin);
+
+    for (auto i = begin; i < head; ++i)
+      events.push_back(buffer->events[i % PROFILE_BUFFER_SIZE]);
+
+    // Skip anything the owning thread overwrote while we were copying
+    auto tail = buffer->head.load(memory_order_acquire);
+    auto skip = tail > begin + PROFILE_BUFFER_SIZE ? tail - begin - PROFILE_BUFFER_SIZE : 0;
+
+    for (auto i = skip; i < events.size(); ++i)
+    {
+      const auto& event = events[i];
+
+      fprintf(
+	file,
+	"%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+	"\"ts\":%.3f,\"dur\":%.3f}",
+	first ? "" : ",",
+	event.name,
+	buffer->thread_id,
+	event.start / 1000.0,
+	(event.end - event.start) / 1000.0);
+
+      first = false;
+      ++count;
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  printf("Profiler: wrote %zu events to %s\n", count, filename.c_str());
+
+  return true;
+}
@@ -0,0 +1,96 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) \
+  ld::ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+namespace ld
+{
+
+static constexpr size_t PROFILE_BUFFER_SIZE = 1 << 15;
+
+struct ProfileEvent
+{
+  const char* name;
+  uint64_t start;
+  uint64_t end;
+};
+
+class Profiler
+{
+  struct Buffer
+  {
+    Buffer(uint32_t thread_id_) : head(0), thread_id(thread_id_) {}
+
+    std::array<ProfileEvent, PROFILE_BUFFER_SIZE> events;
+    std::atomic<uint64_t> head;
+    uint32_t thread_id;
+  };
+
+  Buffer& get_buffer();
+
+  static thread_local Buffer* local_buffer;
+
+  std::atomic<bool> enabled;
+
+  std::mutex buffers_mutex;
+  std::vector<std::unique_ptr<Buffer>> buffers;
+
+  Profiler();
+
+  Profiler(const Profiler&) = delete;
+  void operator=(const Profiler&) = delete;
+
+public:
+  static Profiler& instance()
+  {
+    static Profiler instance;
+
+    return instance;
+  }
+
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+  void set_enabled(bool enabled_) { enabled = enabled_; }
+
+  void record(const char* name, uint64_t start, uint64_t end);
+  bool dump(const std::string& filename);
+};
+
+
+class ProfileScope
+{
+  const char* name;
+  uint64_t start;
+
+public:
+  ProfileScope(const char* name_)
+    : name(Profiler::instance().is_enabled() ? name_ : nullptr),
+      start(name ? Profiler::now() : 0)
+  {}
+
+  ~ProfileScope()
+  {
+    if (name) Profiler::instance().record(name, start, Profiler::now());
+  }
+};
+
+}
+
+#endif /* PROFILER_H */
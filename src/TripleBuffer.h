@@ -0,0 +1,70 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+namespace ld
+{
+
+// One writer fills the back buffer while one reader holds the front buffer.
+// Publishing and acquiring only swap indices, so neither side ever waits on
+// the other's copy.
+template <typename T>
+class TripleBuffer
+{
+  std::array<T, 3> buffers;
+
+  int front, middle, back;
+  bool fresh;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+
+public:
+  TripleBuffer()
+    : buffers(),
+      front(0),
+      middle(1),
+      back(2),
+      fresh(false)
+  {}
+
+  T& get_write_buffer() { return buffers[back]; }
+  const T& get_read_buffer() const { return buffers[front]; }
+
+  void publish()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      std::swap(back, middle);
+      fresh = true;
+    }
+
+    cv.notify_one();
+  }
+
+  bool acquire(double timeout = 0.0)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (!fresh && timeout > 0.0)
+      cv.wait_for(
+	lock, std::chrono::duration<double>(timeout), [this]() { return fresh; });
+
+    if (!fresh) return false;
+
+    std::swap(front, middle);
+    fresh = false;
+
+    return true;
+  }
+};
+
+}
+
+#endif /* TRIPLEBUFFER_H */
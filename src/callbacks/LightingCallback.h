@@ -0,0 +1,43 @@
+#ifndef LIGHTINGCALLBACK_H
+#define LIGHTINGCALLBACK_H
+
+#include <osg/NodeCallback>
+#include <osgUtil/CullVisitor>
+#include "../ClusteredLighting.h"
+
+namespace ld
+{
+
+// Placed on the scene root: recentres the light clusters on the camera
+// being culled and applies the current cluster buffer's state below the
+// root. The state stays static; ClusteredLighting double buffers its data
+// so the draw still in flight never sees it change.
+struct LightingCallback : public osg::NodeCallback
+{
+  osg::ref_ptr<ClusteredLighting> lighting;
+
+  LightingCallback(ClusteredLighting* lighting_)
+    : lighting(lighting_)
+  {}
+
+  virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+  {
+    auto cull_visitor = dynamic_cast<osgUtil::CullVisitor*>(nv);
+
+    if (!cull_visitor)
+    {
+      traverse(node, nv);
+      return;
+    }
+
+    lighting->update(cull_visitor->getEyeLocal());
+
+    cull_visitor->pushStateSet(lighting->get_state_set());
+    traverse(node, nv);
+    cull_visitor->popStateSet();
+  }
+};
+
+}
+
+#endif /* LIGHTINGCALLBACK_H */
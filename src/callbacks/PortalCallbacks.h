@@ -0,0 +1,51 @@
+#ifndef PORTALCALLBACKS_H
+#define PORTALCALLBACKS_H
+
+#include <osg/NodeCallback>
+#include <osgUtil/CullVisitor>
+#include "../PortalGraph.h"
+
+namespace ld
+{
+
+// Placed above all tagged geometry: works out the visible cells for the
+// camera being culled before its subgraph is traversed
+struct PortalGraphCallback : public osg::NodeCallback
+{
+  osg::ref_ptr<PortalGraph> portal_graph;
+
+  PortalGraphCallback(PortalGraph* portal_graph_)
+    : portal_graph(portal_graph_)
+  {}
+
+  virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+  {
+    auto cull_visitor = dynamic_cast<osgUtil::CullVisitor*>(nv);
+
+    if (cull_visitor) portal_graph->update(*cull_visitor);
+
+    traverse(node, nv);
+  }
+};
+
+
+// Skips a subgraph unless one of the cells it can be seen from is visible
+struct CellCullCallback : public osg::NodeCallback
+{
+  osg::ref_ptr<PortalGraph> portal_graph;
+  CellSet cells;
+
+  CellCullCallback(PortalGraph* portal_graph_, const CellSet& cells_)
+    : portal_graph(portal_graph_),
+      cells(cells_)
+  {}
+
+  virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+  {
+    if (portal_graph->is_visible(cells)) traverse(node, nv);
+  }
+};
+
+}
+
+#endif /* PORTALCALLBACKS_H */
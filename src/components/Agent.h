@@ -0,0 +1,36 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include <cstdint>
+#include <osg/Vec3>
+#include "../Constants.h"
+
+namespace ld
+{
+
+struct Agent
+{
+  Agent()
+    : position(),
+      velocity(),
+      steering(),
+      target(),
+      speed(AGENT_SPEED),
+      heading(0.0),
+      wander_angle(0.0),
+      seed(1)
+  {}
+
+  osg::Vec3 position;
+  osg::Vec3 velocity;
+  osg::Vec3 steering;
+  osg::Vec3 target;
+  double speed;
+  double heading;
+  double wander_angle;
+  uint32_t seed;
+};
+
+}
+
+#endif /* AGENT_H */
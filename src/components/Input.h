@@ -8,12 +8,30 @@ struct Input
       backward(false),
       left(false),
       right(false),
-      use(false)
+      use(false),
+      up(false),
+      down(false),
+      activity(false),
+      mouse_dx(0.f),
+      mouse_dy(0.f)
   {}
 
+  void clear_actions()
+  {
+    use = false;
+    up = false;
+    down = false;
+    activity = false;
+    mouse_dx = 0.f;
+    mouse_dy = 0.f;
+  }
+
   bool forward, backward;
   bool left, right;
   bool use;
+  bool up, down;
+  bool activity;
+  float mouse_dx, mouse_dy;
 };
 
 #endif /* INPUT_H */
@@ -0,0 +1,66 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+#include <osg/Matrix>
+#include <osg/Vec3>
+#include "../systems/MapSystem.h"
+#include "Door.h"
+
+namespace ld
+{
+
+struct UserState
+{
+  UserState()
+    : matrix(),
+      position(),
+      heading(0.0),
+      pitch(0.0)
+  {}
+
+  osg::Matrixd matrix;
+  osg::Vec3 position;
+  double heading, pitch;
+};
+
+struct DoorState
+{
+  DoorState(bool open_ = false, bool locked_ = false)
+    : open(open_),
+      locked(locked_)
+  {}
+
+  bool open, locked;
+};
+
+struct Snapshot
+{
+  Snapshot()
+    : tick(0),
+      users(),
+      doors(),
+      doors_version(0),
+      door_layout(),
+      hud_text()
+  {}
+
+  unsigned long long tick;
+
+  std::map<std::string, UserState> users;
+  std::array<std::vector<DoorState>, NUM_FLOORS> doors;
+
+  // The full door list is only copied into a buffer when doors have been
+  // added or removed since that buffer was last written
+  unsigned doors_version;
+  std::array<std::vector<Door>, NUM_FLOORS> door_layout;
+
+  std::string hud_text;
+};
+
+}
+
+#endif /* SNAPSHOT_H */
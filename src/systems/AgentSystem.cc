@@ -0,0 +1,212 @@
+#include "AgentSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include "../Constants.h"
+#include "../Memory.h"
+#include "../Profiler.h"
+
+using namespace ld;
+using namespace osg;
+using namespace std;
+
+static uint32_t next_random(uint32_t& seed)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+
+  return seed;
+}
+
+
+static double unit_random(uint32_t& seed)
+{
+  return next_random(seed) / 4294967296.0;
+}
+
+
+AgentSystem::AgentSystem(
+  std::mt19937& rng_, JobSystem& job_system_, MapSystem& map_system_
+)
+  : rng(rng_),
+    agents(),
+    grid_size((int)std::ceil((MAP_SIZE + 1) / AGENT_SEPARATION_RADIUS)),
+    cell_of(),
+    cell_start(),
+    cell_agents(),
+    job_system(job_system_),
+    map_system(map_system_)
+{
+  MEMORY_SCOPE(MEMORY_AGENT);
+
+  setup_agents();
+
+  printf("Agent System ready\n");
+}
+
+
+void AgentSystem::setup_agents()
+{
+  PROFILE_SCOPE("AgentSystem::setup_agents");
+
+  agents.resize(AGENT_COUNT);
+
+  for (auto& agent : agents)
+  {
+    agent.seed = rng() | 1;
+    agent.position = random_position(agent.seed);
+    agent.target = random_position(agent.seed);
+    agent.heading = 2 * M_PI * unit_random(agent.seed);
+    agent.wander_angle = agent.heading;
+  }
+}
+
+
+Vec3 AgentSystem::random_position(uint32_t& seed)
+{
+  const auto extent = MAP_SIZE / 2 - 2;
+
+  Vec3 position;
+
+  for (auto i = 0; i < 100; ++i)
+  {
+    position.set(
+      std::round(-extent + 2 * extent * unit_random(seed)),
+      std::round(-extent + 2 * extent * unit_random(seed)),
+      0);
+
+    if (!map_system.is_solid(position.x(), position.y(), 0)) break;
+  }
+
+  return position;
+}
+
+
+int AgentSystem::cell_index(const Vec3& position) const
+{
+  auto cx = (int)((position.x() + MAP_SIZE / 2) / AGENT_SEPARATION_RADIUS);
+  auto cy = (int)((position.y() + MAP_SIZE / 2) / AGENT_SEPARATION_RADIUS);
+
+  cx = std::min(std::max(cx, 0), grid_size - 1);
+  cy = std::min(std::max(cy, 0), grid_size - 1);
+
+  return cx + cy * grid_size;
+}
+
+
+void AgentSystem::build_grid()
+{
+  const auto num_cells = grid_size * grid_size;
+
+  cell_of.resize(agents.size());
+  cell_agents.resize(agents.size());
+  cell_start.assign(num_cells + 1, 0);
+
+  for (size_t i = 0; i < agents.size(); ++i)
+  {
+    cell_of[i] = cell_index(agents[i].position);
+    ++cell_start[cell_of[i]];
+  }
+
+  for (auto c = 1; c < num_cells; ++c)
+    cell_start[c] += cell_start[c - 1];
+
+  for (auto i = (int)agents.size() - 1; i >= 0; --i)
+    cell_agents[--cell_start[cell_of[i]]] = i;
+
+  cell_start[num_cells] = agents.size();
+}
+
+
+void AgentSystem::update()
+{
+  PROFILE_SCOPE("AgentSystem::update");
+  MEMORY_SCOPE(MEMORY_AGENT);
+
+  build_grid();
+
+  job_system.parallel_for(
+    agents.size(), AGENT_BATCH_SIZE,
+    [this](size_t begin, size_t end) { steer(begin, end); });
+}
+
+
+void AgentSystem::steer(size_t begin, size_t end)
+{
+  PROFILE_SCOPE("AgentSystem::steer");
+
+  for (auto i = begin; i < end; ++i)
+  {
+    auto& agent = agents[i];
+
+    agent.steering =
+      wander(agent) * AGENT_WANDER_WEIGHT +
+      seek(agent) * AGENT_SEEK_WEIGHT +
+      separate(agent, i) * AGENT_SEPARATION_WEIGHT;
+  }
+}
+
+
+Vec3 AgentSystem::wander(Agent& agent)
+{
+  agent.wander_angle += (2 * unit_random(agent.seed) - 1) * AGENT_WANDER_JITTER;
+
+  return Vec3(std::sin(agent.wander_angle), -std::cos(agent.wander_angle), 0);
+}
+
+
+Vec3 AgentSystem::seek(Agent& agent)
+{
+  Vec3 direction(agent.target - agent.position);
+  direction.z() = 0;
+
+  if (direction.length2() < 1.0)
+  {
+    agent.target = random_position(agent.seed);
+
+    direction = agent.target - agent.position;
+    direction.z() = 0;
+  }
+
+  direction.normalize();
+
+  return direction;
+}
+
+
+Vec3 AgentSystem::separate(const Agent& agent, size_t index) const
+{
+  const auto radius2 = AGENT_SEPARATION_RADIUS * AGENT_SEPARATION_RADIUS;
+  const auto cell = cell_of[index];
+  const auto cx = cell % grid_size;
+  const auto cy = cell / grid_size;
+
+  Vec3 force;
+
+  for (auto y = std::max(cy - 1, 0); y <= std::min(cy + 1, grid_size - 1); ++y)
+  {
+    for (auto x = std::max(cx - 1, 0); x <= std::min(cx + 1, grid_size - 1); ++x)
+    {
+      const auto c = x + y * grid_size;
+
+      for (auto n = cell_start[c]; n < cell_start[c + 1]; ++n)
+      {
+	const auto other = (size_t)cell_agents[n];
+
+	if (other == index) continue;
+
+	Vec3 offset(agent.position - agents[other].position);
+	offset.z() = 0;
+
+	const auto dist2 = offset.length2();
+
+	if (dist2 > 0 && dist2 < radius2) force += offset / dist2;
+      }
+    }
+  }
+
+  if (force.length2() > 1) force.normalize();
+
+  return force;
+}
@@ -0,0 +1,54 @@
+#ifndef AGENTSYSTEM_H
+#define AGENTSYSTEM_H
+
+#include <random>
+#include <vector>
+#include <osg/Vec3>
+#include "JobSystem.h"
+#include "MapSystem.h"
+#include "../components/Agent.h"
+
+namespace ld
+{
+
+class AgentSystem
+{
+  void setup_agents();
+  void build_grid();
+
+  void steer(size_t begin, size_t end);
+
+  osg::Vec3 wander(Agent& agent);
+  osg::Vec3 seek(Agent& agent);
+  osg::Vec3 separate(const Agent& agent, size_t index) const;
+
+  osg::Vec3 random_position(uint32_t& seed);
+  int cell_index(const osg::Vec3& position) const;
+
+  std::mt19937& rng;
+
+  std::vector<Agent> agents;
+
+  int grid_size;
+  std::vector<int> cell_of;
+  std::vector<int> cell_start;
+  std::vector<int> cell_agents;
+
+  JobSystem& job_system;
+  MapSystem& map_system;
+
+public:
+  static constexpr unsigned READS = MAP_DATA;
+  static constexpr unsigned WRITES = AGENT_DATA;
+
+  AgentSystem(std::mt19937& rng, JobSystem& job_system, MapSystem& map_system);
+
+  void update();
+
+  std::vector<Agent>& get_agents() { return agents; }
+  const std::vector<Agent>& get_agents() const { return agents; }
+};
+
+}
+
+#endif /* AGENTSYSTEM_H */
@@ -1,30 +1,58 @@
 #include "CameraSystem.h"
 
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <osg/PositionAttitudeTransform>
+#include <osgDB/DatabasePager>
 #include <osgGA/GUIEventHandler>
+#include <osgUtil/RenderBin>
 #include <osgViewer/CompositeViewer>
 #include <osgViewer/ViewerEventHandlers>
 #include "../Constants.h"
 #include "../InputAdapter.h"
-#include "../callbacks/DebugTextCallback.h"
-#include "../components/DynamicEntity.h"
+#include "../Memory.h"
+#include "../Profiler.h"
+#include "MapSystem.h"
 
 using namespace ld;
 using namespace osg;
 
+class RealizeOperation : public GraphicsOperation
+{
+  std::function<void(GraphicsContext*)> handler;
+
+public:
+  RealizeOperation(std::function<void(GraphicsContext*)> handler_)
+    : GraphicsOperation("RealizeOperation", false),
+      handler(handler_)
+  {}
+
+  virtual void operator()(GraphicsContext* context)
+  {
+    handler(context);
+  }
+};
+
+
 CameraSystem::CameraSystem(
   ref_ptr<Group> root,
   Input& input,
-  EntitySystem& entity_system_
+  std::mutex& input_mutex
 )
   : running(true),
     active_cursor(true),
-    entity_system(entity_system_),
     viewer(),
     debug_text_object(new osgText::Text)
 {
+  MEMORY_SCOPE(MEMORY_RENDER);
+
+  // Bins keep drawables grouped by state graph, and order the groups front
+  // to back so shared materials are applied once and hidden fragments are
+  // rejected early. Must be set before the views create their render stages.
+  osgUtil::RenderBin::setDefaultRenderBinSortMode(
+    osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK);
+
   auto view = new osgViewer::View;
   viewer.addView(view);
 
@@ -32,7 +60,9 @@ CameraSystem::CameraSystem(
   view->setUpViewAcrossAllScreens();
   view->getCamera()->setProjectionMatrixAsPerspective(
     FOV, ASPECT_RATIO, NEAR_CLIP, FAR_CLIP);
-  view->addEventHandler(new InputAdapter(input, entity_system, *this));
+  view->addEventHandler(new InputAdapter(input, input_mutex, *this));
+
+  setup_paging(view);
 
   auto stats_handler = new osgViewer::StatsHandler;
   stats_handler->setKeyEventTogglesOnScreenStats(osgGA::GUIEventAdapter::KEY_O);
@@ -47,6 +77,8 @@ CameraSystem::CameraSystem(
 
   viewer.addView(hud_view);
 
+  setup_threading();
+
   printf("Camera System ready\n");
 }
 
@@ -64,7 +96,6 @@ Camera* CameraSystem::setup_HUD(osgViewer::Viewer::Windows& windows)
 
   debug_text_object->setFont("fonts/Vera.ttf");
   debug_text_object->setDataVariance(Object::DYNAMIC);
-  debug_text_object->setDrawCallback(new DebugTextCallback);
   debug_text_object->setText("Must not be empty!!!");
 
   auto geode = new Geode;
@@ -81,23 +112,60 @@ Camera* CameraSystem::setup_HUD(osgViewer::Viewer::Windows& windows)
 }
 
 
-void CameraSystem::update()
+// Room for every chunk that fits within the far clip plane, the pager
+// expires chunks beyond that
+void CameraSystem::setup_paging(osgViewer::View* view)
+{
+  auto chunks_across = (int)std::ceil(2 * FAR_CLIP / (CHUNK_SIZE * TILE_SIZE)) + 1;
+
+  auto pager = view->getDatabasePager();
+  pager->setUpThreads(PAGER_THREADS + 1, 1);
+  pager->setDoPreCompile(true);
+  pager->setTargetMaximumNumberOfPageLOD(chunks_across * chunks_across * NUM_FLOORS);
+}
+
+
+void CameraSystem::setup_threading()
 {
+  const std::map<std::string, osgViewer::ViewerBase::ThreadingModel> models{
+    {"SingleThreaded", osgViewer::ViewerBase::SingleThreaded},
+    {"CullDrawThreadPerContext", osgViewer::ViewerBase::CullDrawThreadPerContext},
+    {"DrawThreadPerContext", osgViewer::ViewerBase::DrawThreadPerContext},
+    {"CullThreadPerCameraDrawThreadPerContext",
+     osgViewer::ViewerBase::CullThreadPerCameraDrawThreadPerContext}};
+
+  auto model = models.find(VIEWER_THREADING);
+
+  if (model == models.end())
+  {
+    printf("Unknown viewer threading '%s'\n", VIEWER_THREADING.c_str());
+    return;
+  }
+
+  viewer.setThreadingModel(model->second);
+}
+
+
+void CameraSystem::set_realize_handler(std::function<void(GraphicsContext*)> handler)
+{
+  viewer.setRealizeOperation(new RealizeOperation(handler));
+}
+
+
+void CameraSystem::update(const Snapshot& snapshot)
+{
+  PROFILE_SCOPE("CameraSystem::update");
+  MEMORY_SCOPE(MEMORY_RENDER);
+
   if (viewer.done())
   {
     running = false;
     return;
   }
 
-  const auto& user = entity_system.get_user("kadijah");
-
-  // Debug user position
-  std::ostringstream ss;
-  ss.precision(1);
-  ss.setf(std::ios::fixed);
-  ss << user.position.x() << " " << user.position.y() << " " << user.position.z();
+  const auto& user = snapshot.users.at("kadijah");
 
-  Debug::instance().msg = ss.str();
+  debug_text_object->setText(snapshot.hud_text);
 
   Quat user_orient(user.pitch, Vec3(1, 0, 0), 0, Vec3(), user.heading, Vec3(0, 0, 1));
 
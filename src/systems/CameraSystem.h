@@ -1,6 +1,8 @@
 #ifndef CAMERASYSTEM_H
 #define CAMERASYSTEM_H
 
+#include <functional>
+#include <mutex>
 #include <string>
 #include <osg/Group>
 #include <osg/PositionAttitudeTransform>
@@ -8,8 +10,8 @@
 #include <osgText/Text>
 #include <osgViewer/Viewer>
 #include <osgViewer/CompositeViewer>
-#include "EntitySystem.h"
 #include "../components/Input.h"
+#include "../components/Snapshot.h"
 
 namespace ld
 {
@@ -25,18 +27,21 @@ class CameraSystem
   bool running;
   bool active_cursor;
 
-  EntitySystem& entity_system;
-
   osgViewer::CompositeViewer viewer;
   osg::ref_ptr<osgText::Text> debug_text_object;
 
   osg::Camera* setup_HUD(osgViewer::Viewer::Windows& windows);
+  void setup_paging(osgViewer::View* view);
+  void setup_threading();
 
 public:
   CameraSystem(
-    osg::ref_ptr<osg::Group> root, Input& input, EntitySystem& entity_system);
+    osg::ref_ptr<osg::Group> root, Input& input, std::mutex& input_mutex);
+
+  // Runs once the windows exist, with their context current
+  void set_realize_handler(std::function<void(osg::GraphicsContext*)> handler);
 
-  void update();
+  void update(const Snapshot& snapshot);
   bool is_running() const { return running; }
   bool has_active_cursor() const { return active_cursor; }
   void show_cursor(bool show);
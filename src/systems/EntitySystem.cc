@@ -1,7 +1,10 @@
 #include "EntitySystem.h"
 
-#include <iostream>
 #include "../Constants.h"
+#include "../Counters.h"
+#include "../Log.h"
+#include "../Memory.h"
+#include "../Profiler.h"
 #include "../components/DynamicEntity.h"
 
 using namespace ld;
@@ -11,9 +14,12 @@ EntitySystem::EntitySystem(
   std::mt19937& rng_, Input& input_, MapSystem& map_system_
 )
   : rng(rng_),
+    doors_version(0),
     input(input_),
     map_system(map_system_)
 {
+  MEMORY_SCOPE(MEMORY_ENTITY);
+
   setup_users();
   setup_doors();
 
@@ -33,6 +39,8 @@ void EntitySystem::setup_users()
 
 void EntitySystem::setup_doors()
 {
+  PROFILE_SCOPE("EntitySystem::setup_doors");
+
   const auto& rooms = map_system.get_rooms();
 
   for (auto floor = 0; floor < NUM_FLOORS; ++floor)
@@ -116,24 +124,56 @@ void EntitySystem::create_door(
   int x, int y, int floor, string type, string name, double rotation)
 {
   doors[floor].push_back({x, y, type, name, rotation});
+  ++doors_version;
   map_system.set_tile(x, y, floor, type, name + "-frame", rotation);
 }
 
 
+const Door* EntitySystem::find_door(int x, int y, int floor) const
+{
+  for (const auto& door : doors[floor])
+    if (door.x == x && door.y == y) return &door;
+
+  return nullptr;
+}
+
+
 void EntitySystem::update()
 {
+  PROFILE_SCOPE("EntitySystem::update");
+  MEMORY_SCOPE(MEMORY_ENTITY);
+
+  auto& user = users["kadijah"];
+
+  user.heading -= user.x_rot_speed * input.mouse_dx;
+  user.pitch -= user.y_rot_speed * input.mouse_dy;
+
+  const double max_pitch = osg::inDegrees(89.f);
+
+  if (user.pitch > max_pitch) user.pitch = max_pitch;
+  else if (user.pitch < -max_pitch) user.pitch = -max_pitch;
+
+  input.mouse_dx = 0.f;
+  input.mouse_dy = 0.f;
+
+  if (input.up || input.down)
+  {
+    user.inactive_time = 1.0;
+    user.start = user.position;
+    user.target = user.start + osg::Vec3(0, 0, input.up ? 1 : -1);
+
+    input.up = false;
+    input.down = false;
+  }
+
   if (input.use)
   {
     const auto& regions = map_system.get_regions();
 
-    for (const auto& region : regions[users["kadijah"].position.z()])
-    {
-      std::cout <<
-	region.x << " " <<
-	region.y << " " <<
-	region.w << " " <<
-	region.h << std::endl;
-    }
+    Counters::add(COUNTER_REGIONS_SCANNED, regions[user.position.z()].size());
+
+    for (const auto& region : regions[user.position.z()])
+      LOG_INFO("Region %d %d %d %d\n", region.x, region.y, region.w, region.h);
 
     input.use = false;
   }
@@ -4,6 +4,7 @@
 #include <string>
 #include <random>
 #include <osg/Node>
+#include "JobSystem.h"
 #include "MapSystem.h"
 #include "../components/Door.h"
 #include "../components/DynamicEntity.h"
@@ -23,18 +24,26 @@ class EntitySystem
 
   std::map<std::string, DynamicEntity> users;
   std::array<std::vector<Door>, NUM_FLOORS> doors;
+  unsigned doors_version;
 
   Input& input;
   MapSystem& map_system;
 
 public:
+  static constexpr unsigned READS = INPUT_DATA | MAP_DATA;
+  static constexpr unsigned WRITES = INPUT_DATA | ENTITY_DATA;
+
   EntitySystem(std::mt19937& rng, Input& input, MapSystem& map_system);
 
   void update();
 
   DynamicEntity& get_user(const std::string& name) { return users[name]; }
+  const std::map<std::string, DynamicEntity>& get_users() const { return users; }
 
   const std::array<std::vector<Door>, NUM_FLOORS>& get_doors() const { return doors; }
+  unsigned get_doors_version() const { return doors_version; }
+
+  const Door* find_door(int x, int y, int floor) const;
 };
 
 }
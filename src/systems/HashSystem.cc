@@ -0,0 +1,444 @@
+#include "HashSystem.h"
+
+#include <cstring>
+#include "../Constants.h"
+#include "../Log.h"
+#include "../Profiler.h"
+
+using namespace ld;
+using namespace osg;
+using namespace std;
+
+static const char HASH_MAGIC[4] = {'L', 'D', 'H', 'S'};
+
+static const char* HASH_NAMES[NUM_HASHES] =
+{
+  "tiles", "rooms", "regions", "doors", "users", "agents"
+};
+
+static uint64_t combine(uint64_t hash, uint64_t value)
+{
+  value *= 0x9e3779b97f4a7c15ULL;
+  value ^= value >> 32;
+
+  hash ^= value;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+
+static uint64_t combine(uint64_t hash, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  return combine(hash, (uint64_t)bits);
+}
+
+
+static uint64_t combine(uint64_t hash, double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  return combine(hash, bits);
+}
+
+
+static uint64_t combine(uint64_t hash, const Vec3& value)
+{
+  hash = combine(hash, value.x());
+  hash = combine(hash, value.y());
+  return combine(hash, value.z());
+}
+
+
+static uint64_t combine(uint64_t hash, const string& value)
+{
+  // FNV-1a over the characters, then mixed in like any other value
+  uint64_t fnv = 0xcbf29ce484222325ULL;
+
+  for (auto c : value)
+  {
+    fnv ^= (unsigned char)c;
+    fnv *= 0x100000001b3ULL;
+  }
+
+  return combine(hash, fnv);
+}
+
+
+static uint64_t combine(uint64_t hash, const Rect& rect)
+{
+  hash = combine(hash, (uint64_t)(int64_t)rect.x);
+  hash = combine(hash, (uint64_t)(int64_t)rect.y);
+  hash = combine(hash, (uint64_t)(int64_t)rect.w);
+  return combine(hash, (uint64_t)(int64_t)rect.h);
+}
+
+
+HashSystem::HashSystem(
+  const string& log_file_, const string& verify_file_,
+  JobSystem& job_system_, MapSystem& map_system_,
+  EntitySystem& entity_system_, AgentSystem& agent_system_)
+  : enabled(false),
+    log_file(nullptr),
+    verify_file(nullptr),
+    tick(0),
+    hashes(),
+    chunk_hashes(),
+    chunk_versions(),
+    rooms_version(0),
+    regions_version(0),
+    doors_version(0),
+    doors_layout_hash(0),
+    agent_hashes(),
+    diverged(false),
+    verified_ticks(0),
+    job_system(job_system_),
+    map_system(map_system_),
+    entity_system(entity_system_),
+    agent_system(agent_system_)
+{
+  if (!log_file_.empty())
+  {
+    log_file = fopen(log_file_.c_str(), "wb");
+
+    if (log_file)
+    {
+      uint32_t num_hashes = NUM_HASHES;
+
+      fwrite(HASH_MAGIC, sizeof(HASH_MAGIC), 1, log_file);
+      fwrite(&HASH_VERSION, sizeof(HASH_VERSION), 1, log_file);
+      fwrite(&num_hashes, sizeof(num_hashes), 1, log_file);
+    }
+    else
+      printf("Could not open %s for hash log\n", log_file_.c_str());
+  }
+
+  if (!verify_file_.empty())
+  {
+    verify_file = fopen(verify_file_.c_str(), "rb");
+
+    char magic[4];
+    uint32_t version = 0, num_hashes = 0;
+
+    auto valid =
+      verify_file &&
+      fread(magic, sizeof(magic), 1, verify_file) == 1 &&
+      memcmp(magic, HASH_MAGIC, sizeof(magic)) == 0 &&
+      fread(&version, sizeof(version), 1, verify_file) == 1 &&
+      version == HASH_VERSION &&
+      fread(&num_hashes, sizeof(num_hashes), 1, verify_file) == 1 &&
+      num_hashes == NUM_HASHES;
+
+    if (!valid)
+    {
+      printf("Could not read hash log %s\n", verify_file_.c_str());
+
+      if (verify_file) fclose(verify_file);
+      verify_file = nullptr;
+    }
+  }
+
+  enabled = log_file || verify_file;
+
+  // Versions start one behind so every chunk is hashed on the first tick
+  for (auto& floor_versions : chunk_versions)
+    floor_versions.fill(~0u);
+
+  rooms_version = regions_version = doors_version = ~0u;
+
+  printf("Hash System ready\n");
+}
+
+
+HashSystem::~HashSystem()
+{
+  if (verify_file)
+  {
+    if (!diverged)
+      printf("World hashes matched for %llu ticks\n", verified_ticks);
+
+    fclose(verify_file);
+  }
+
+  if (log_file) fclose(log_file);
+}
+
+
+void HashSystem::update()
+{
+  if (!enabled) return;
+
+  PROFILE_SCOPE("HashSystem::update");
+
+  hash_tiles();
+  hash_rooms();
+  hash_regions();
+  hash_doors();
+  hash_users();
+  hash_agents();
+
+  if (log_file) write_record();
+  if (verify_file) verify_record();
+
+  ++tick;
+}
+
+
+void HashSystem::hash_tiles()
+{
+  uint64_t hash = 0;
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    for (auto chunk = 0; chunk < CHUNKS_PER_SIDE * CHUNKS_PER_SIDE; ++chunk)
+    {
+      auto version = map_system.get_chunk_version(chunk, floor);
+
+      if (version != chunk_versions[floor][chunk])
+      {
+	chunk_versions[floor][chunk] = version;
+
+	auto rect = MapSystem::get_chunk_rect(chunk);
+
+	uint64_t chunk_hash = 0;
+
+	for (auto x = rect.x; x < rect.x + rect.w; ++x)
+	{
+	  for (auto y = rect.y; y < rect.y + rect.h; ++y)
+	  {
+	    const auto& tile = map_system.get_tile(x, y, floor);
+
+	    chunk_hash = combine(chunk_hash, (uint64_t)tile.solid);
+	    chunk_hash = combine(chunk_hash, tile.position);
+	    chunk_hash = combine(chunk_hash, tile.type);
+	    chunk_hash = combine(chunk_hash, tile.name);
+	    chunk_hash = combine(chunk_hash, tile.rotation);
+	    chunk_hash = combine(chunk_hash, tile.ceil_type);
+	    chunk_hash = combine(chunk_hash, tile.ceil_name);
+	    chunk_hash = combine(chunk_hash, tile.ceil_rotation);
+	  }
+	}
+
+	chunk_hashes[floor][chunk] = chunk_hash;
+      }
+
+      hash = combine(hash, chunk_hashes[floor][chunk]);
+    }
+  }
+
+  hashes[HASH_TILES] = hash;
+}
+
+
+void HashSystem::hash_rooms()
+{
+  if (map_system.get_rooms_version() == rooms_version) return;
+
+  rooms_version = map_system.get_rooms_version();
+
+  uint64_t hash = 0;
+
+  for (const auto& floor_rooms : map_system.get_rooms())
+  {
+    hash = combine(hash, (uint64_t)floor_rooms.size());
+
+    for (const auto& room : floor_rooms)
+      hash = combine(hash, room);
+  }
+
+  hashes[HASH_ROOMS] = hash;
+}
+
+
+void HashSystem::hash_regions()
+{
+  if (map_system.get_regions_version() == regions_version) return;
+
+  regions_version = map_system.get_regions_version();
+
+  uint64_t hash = 0;
+
+  for (const auto& floor_regions : map_system.get_regions())
+  {
+    hash = combine(hash, (uint64_t)floor_regions.size());
+
+    for (const auto& region : floor_regions)
+    {
+      hash = combine(hash, region);
+      hash = combine(hash, (uint64_t)(region.object != nullptr));
+    }
+  }
+
+  hashes[HASH_REGIONS] = hash;
+}
+
+
+// The doors version only changes with the layout; doors open and lock
+// without it, so their state is hashed every tick
+void HashSystem::hash_doors()
+{
+  if (entity_system.get_doors_version() != doors_version)
+  {
+    doors_version = entity_system.get_doors_version();
+
+    uint64_t hash = 0;
+
+    for (const auto& floor_doors : entity_system.get_doors())
+    {
+      hash = combine(hash, (uint64_t)floor_doors.size());
+
+      for (const auto& door : floor_doors)
+      {
+	hash = combine(hash, (uint64_t)(int64_t)door.x);
+	hash = combine(hash, (uint64_t)(int64_t)door.y);
+	hash = combine(hash, door.type);
+	hash = combine(hash, door.name);
+	hash = combine(hash, door.rotation);
+      }
+    }
+
+    doors_layout_hash = hash;
+  }
+
+  auto hash = doors_layout_hash;
+
+  for (const auto& floor_doors : entity_system.get_doors())
+  {
+    for (const auto& door : floor_doors)
+    {
+      hash = combine(hash, (uint64_t)door.locked);
+      hash = combine(hash, (uint64_t)door.open);
+    }
+  }
+
+  hashes[HASH_DOORS] = hash;
+}
+
+
+void HashSystem::hash_users()
+{
+  uint64_t hash = 0;
+
+  for (const auto& key_value : entity_system.get_users())
+  {
+    const auto& user = key_value.second;
+
+    hash = combine(hash, key_value.first);
+    hash = combine(hash, user.position);
+    hash = combine(hash, user.heading);
+    hash = combine(hash, user.pitch);
+  }
+
+  hashes[HASH_USERS] = hash;
+}
+
+
+void HashSystem::hash_agents()
+{
+  const auto& agents = agent_system.get_agents();
+  const size_t batch_size = AGENT_BATCH_SIZE;
+
+  // Batches are fixed by AGENT_BATCH_SIZE rather than thread count, so the
+  // combined hash does not depend on how many workers ran them
+  agent_hashes.assign((agents.size() + batch_size - 1) / batch_size, 0);
+
+  job_system.parallel_for(
+    agents.size(), batch_size,
+    [this, &agents, batch_size](size_t begin, size_t end)
+    {
+      uint64_t hash = 0;
+
+      for (auto i = begin; i < end; ++i)
+      {
+	hash = combine(hash, agents[i].position);
+	hash = combine(hash, agents[i].heading);
+      }
+
+      agent_hashes[begin / batch_size] = hash;
+    });
+
+  uint64_t hash = combine((uint64_t)0, (uint64_t)agents.size());
+
+  for (auto batch_hash : agent_hashes)
+    hash = combine(hash, batch_hash);
+
+  hashes[HASH_AGENTS] = hash;
+}
+
+
+void HashSystem::write_record()
+{
+  uint64_t record_tick = tick;
+
+  fwrite(&record_tick, sizeof(record_tick), 1, log_file);
+  fwrite(hashes.data(), sizeof(uint64_t), NUM_HASHES, log_file);
+}
+
+
+void HashSystem::verify_record()
+{
+  if (diverged) return;
+
+  uint64_t expected_tick;
+  array<uint64_t, NUM_HASHES> expected;
+
+  auto valid =
+    fread(&expected_tick, sizeof(expected_tick), 1, verify_file) == 1 &&
+    fread(expected.data(), sizeof(uint64_t), NUM_HASHES, verify_file) == NUM_HASHES;
+
+  if (!valid)
+  {
+    LOG_WARNING("Hash log ended after %llu ticks\n", verified_ticks);
+
+    diverged = true;
+    return;
+  }
+
+  if (expected_tick != tick)
+  {
+    LOG_ERROR(
+      "Hash log out of step at tick %llu: record is for tick %llu\n",
+      tick, (unsigned long long)expected_tick);
+
+    diverged = true;
+    return;
+  }
+
+  for (auto i = 0; i < NUM_HASHES; ++i)
+  {
+    if (expected[i] != hashes[i])
+    {
+      LOG_ERROR(
+	"Divergence at tick %llu in %s: expected %016llx, got %016llx\n",
+	tick, HASH_NAMES[i],
+	(unsigned long long)expected[i], (unsigned long long)hashes[i]);
+
+      diverged = true;
+      return;
+    }
+  }
+
+  ++verified_ticks;
+}
+
+
+uint64_t HashSystem::get_world_hash() const
+{
+  uint64_t hash = 0;
+
+  for (auto value : hashes)
+    hash = combine(hash, value);
+
+  return hash;
+}
+
+
+const char* HashSystem::get_name(WorldHashes hash)
+{
+  return HASH_NAMES[hash];
+}
@@ -0,0 +1,92 @@
+#ifndef HASHSYSTEM_H
+#define HASHSYSTEM_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+#include "MapSystem.h"
+#include "EntitySystem.h"
+#include "AgentSystem.h"
+
+namespace ld
+{
+
+// Hash logs start with a header (magic, version, hash count) followed by one
+// record per tick: the tick number and one hash per subsystem. Hashes only
+// depend on simulation state, so logs from two runs with the same seed and
+// input, or from a recording and its replay, must match tick for tick.
+static constexpr uint32_t HASH_VERSION = 2;
+
+enum WorldHashes
+{
+  HASH_TILES,
+  HASH_ROOMS,
+  HASH_REGIONS,
+  HASH_DOORS,
+  HASH_USERS,
+  HASH_AGENTS,
+  NUM_HASHES
+};
+
+class HashSystem
+{
+  void hash_tiles();
+  void hash_rooms();
+  void hash_regions();
+  void hash_doors();
+  void hash_users();
+  void hash_agents();
+
+  void write_record();
+  void verify_record();
+
+  bool enabled;
+
+  FILE* log_file;
+  FILE* verify_file;
+
+  unsigned long long tick;
+  std::array<uint64_t, NUM_HASHES> hashes;
+
+  std::array<std::array<uint64_t, CHUNKS_PER_SIDE * CHUNKS_PER_SIDE>, NUM_FLOORS> chunk_hashes;
+  std::array<std::array<unsigned, CHUNKS_PER_SIDE * CHUNKS_PER_SIDE>, NUM_FLOORS> chunk_versions;
+  unsigned rooms_version, regions_version, doors_version;
+  uint64_t doors_layout_hash;
+
+  std::vector<uint64_t> agent_hashes;
+
+  bool diverged;
+  unsigned long long verified_ticks;
+
+  JobSystem& job_system;
+  MapSystem& map_system;
+  EntitySystem& entity_system;
+  AgentSystem& agent_system;
+
+public:
+  static constexpr unsigned READS = MAP_DATA | ENTITY_DATA | AGENT_DATA;
+  static constexpr unsigned WRITES = 0;
+
+  HashSystem(
+    const std::string& log_file, const std::string& verify_file,
+    JobSystem& job_system, MapSystem& map_system,
+    EntitySystem& entity_system, AgentSystem& agent_system);
+  ~HashSystem();
+
+  void update();
+
+  bool is_enabled() const { return enabled; }
+  bool has_diverged() const { return diverged; }
+
+  uint64_t get_hash(WorldHashes hash) const { return hashes[hash]; }
+  uint64_t get_world_hash() const;
+
+  static const char* get_name(WorldHashes hash);
+};
+
+}
+
+#endif /* HASHSYSTEM_H */
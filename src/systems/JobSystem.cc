@@ -0,0 +1,282 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <iostream>
+#include "../Constants.h"
+#include "../Memory.h"
+
+using namespace ld;
+using namespace std;
+
+static thread_local size_t worker_index = 0;
+
+JobSystem::JobSystem()
+  : running(true),
+    pending(0),
+    sleep_mutex(),
+    sleep_cv(),
+    queues(),
+    workers()
+{
+  MEMORY_SCOPE(MEMORY_JOBS);
+
+  size_t num_threads = JOB_THREADS > 0 ? JOB_THREADS : thread::hardware_concurrency();
+
+  if (num_threads < 1) num_threads = 1;
+
+  for (size_t i = 0; i < num_threads; ++i)
+    queues.emplace_back(new Queue);
+
+  for (size_t i = 1; i < num_threads; ++i)
+    workers.emplace_back(&JobSystem::work, this, i);
+
+  printf("Job System ready\n");
+}
+
+
+JobSystem::~JobSystem()
+{
+  running = false;
+
+  {
+    lock_guard<mutex> lock(sleep_mutex);
+  }
+  sleep_cv.notify_all();
+
+  for (auto& worker : workers)
+    worker.join();
+}
+
+
+void JobSystem::work(size_t index)
+{
+  worker_index = index;
+
+  while (running)
+  {
+    if (run_one()) continue;
+
+    unique_lock<mutex> lock(sleep_mutex);
+    sleep_cv.wait(lock, [this]() { return !running || pending > 0; });
+  }
+}
+
+
+void JobSystem::submit(Job job)
+{
+  auto& queue = *queues[worker_index];
+
+  {
+    lock_guard<mutex> lock(queue.mutex);
+    queue.jobs.push_back(std::move(job));
+  }
+
+  ++pending;
+
+  {
+    lock_guard<mutex> lock(sleep_mutex);
+  }
+  sleep_cv.notify_one();
+}
+
+
+bool JobSystem::pop(size_t index, Job& job)
+{
+  auto& queue = *queues[index];
+
+  lock_guard<mutex> lock(queue.mutex);
+
+  if (queue.jobs.empty()) return false;
+
+  job = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  --pending;
+
+  return true;
+}
+
+
+bool JobSystem::steal(size_t index, Job& job)
+{
+  for (size_t i = 1; i < queues.size(); ++i)
+  {
+    auto& queue = *queues[(index + i) % queues.size()];
+
+    lock_guard<mutex> lock(queue.mutex);
+
+    if (queue.jobs.empty()) continue;
+
+    job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    --pending;
+
+    return true;
+  }
+
+  return false;
+}
+
+
+bool JobSystem::run_one()
+{
+  Job job;
+
+  if (pop(worker_index, job) || steal(worker_index, job))
+  {
+    job();
+    return true;
+  }
+
+  return false;
+}
+
+
+void JobSystem::parallel_for(
+  size_t count, size_t batch_size,
+  const function<void(size_t begin, size_t end)>& fn)
+{
+  if (count == 0) return;
+
+  if (batch_size < 1) batch_size = 1;
+
+  struct Batches
+  {
+    const function<void(size_t, size_t)>* fn;
+    size_t count, batch_size;
+    atomic<size_t> done;
+    MemoryTag tag;
+  } batches;
+
+  batches.fn = &fn;
+  batches.count = count;
+  batches.batch_size = batch_size;
+  batches.done = 0;
+  batches.tag = MemoryTracker::get_tag();
+
+  const auto num_batches = (count + batch_size - 1) / batch_size;
+
+  for (size_t batch = 0; batch < num_batches; ++batch)
+  {
+    auto context = &batches;
+
+    submit(
+      [context, batch]()
+      {
+	// Charge the batch to whoever called parallel_for
+	MEMORY_SCOPE(context->tag);
+
+	auto begin = batch * context->batch_size;
+	auto end = std::min(context->count, begin + context->batch_size);
+
+	(*context->fn)(begin, end);
+	++context->done;
+      });
+  }
+
+  while (batches.done < num_batches)
+    if (!run_one()) this_thread::yield();
+}
+
+
+TaskGraph::TaskGraph(JobSystem& job_system_)
+  : tasks(),
+    blockers(),
+    remaining(0),
+    main_mutex(),
+    main_ready(),
+    job_system(job_system_)
+{}
+
+
+size_t TaskGraph::add(
+  const string& name, unsigned reads, unsigned writes, Job fn, bool main_thread)
+{
+  Task task;
+  task.name = name;
+  task.reads = reads;
+  task.writes = writes;
+  task.main_thread = main_thread;
+  task.fn = std::move(fn);
+  task.num_dependencies = 0;
+
+  const auto index = tasks.size();
+
+  for (auto& other : tasks)
+  {
+    auto conflict =
+      (other.writes & (reads | writes)) != 0 ||
+      (other.reads & writes) != 0;
+
+    if (conflict)
+    {
+      other.dependents.push_back(index);
+      ++task.num_dependencies;
+    }
+  }
+
+  tasks.push_back(std::move(task));
+  blockers.reset(new atomic<int>[tasks.size()]);
+
+  return index;
+}
+
+
+void TaskGraph::run()
+{
+  remaining = tasks.size();
+
+  for (size_t i = 0; i < tasks.size(); ++i)
+    blockers[i] = tasks[i].num_dependencies;
+
+  for (size_t i = 0; i < tasks.size(); ++i)
+    if (tasks[i].num_dependencies == 0) launch(i);
+
+  while (remaining > 0)
+  {
+    auto has_task = false;
+    size_t index = 0;
+
+    {
+      lock_guard<mutex> lock(main_mutex);
+
+      if (!main_ready.empty())
+      {
+	index = main_ready.front();
+	main_ready.pop_front();
+	has_task = true;
+      }
+    }
+
+    if (has_task)
+      execute(index);
+    else if (!job_system.run_one())
+      this_thread::yield();
+  }
+}
+
+
+void TaskGraph::launch(size_t index)
+{
+  if (tasks[index].main_thread)
+  {
+    lock_guard<mutex> lock(main_mutex);
+    main_ready.push_back(index);
+  }
+  else
+  {
+    job_system.submit([this, index]() { execute(index); });
+  }
+}
+
+
+void TaskGraph::execute(size_t index)
+{
+  auto& task = tasks[index];
+
+  task.fn();
+
+  for (auto dependent : task.dependents)
+    if (--blockers[dependent] == 0) launch(dependent);
+
+  --remaining;
+}
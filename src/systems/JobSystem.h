@@ -0,0 +1,102 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ld
+{
+
+enum Resources
+{
+  INPUT_DATA = 1 << 0,
+  MAP_DATA = 1 << 1,
+  ENTITY_DATA = 1 << 2,
+  AGENT_DATA = 1 << 3,
+  TRANSFORM_DATA = 1 << 4,
+  SCENE_DATA = 1 << 5
+};
+
+typedef std::function<void()> Job;
+
+class JobSystem
+{
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  void work(size_t index);
+
+  bool pop(size_t index, Job& job);
+  bool steal(size_t index, Job& job);
+
+  std::atomic<bool> running;
+  std::atomic<int> pending;
+
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+public:
+  JobSystem();
+  ~JobSystem();
+
+  void submit(Job job);
+  bool run_one();
+
+  void parallel_for(
+    size_t count, size_t batch_size,
+    const std::function<void(size_t begin, size_t end)>& fn);
+
+  size_t get_num_threads() const { return queues.size(); }
+};
+
+
+class TaskGraph
+{
+  struct Task
+  {
+    std::string name;
+    unsigned reads, writes;
+    bool main_thread;
+    Job fn;
+    std::vector<size_t> dependents;
+    int num_dependencies;
+  };
+
+  void launch(size_t index);
+  void execute(size_t index);
+
+  std::vector<Task> tasks;
+  std::unique_ptr<std::atomic<int>[]> blockers;
+  std::atomic<int> remaining;
+
+  std::mutex main_mutex;
+  std::deque<size_t> main_ready;
+
+  JobSystem& job_system;
+
+public:
+  TaskGraph(JobSystem& job_system);
+
+  size_t add(
+    const std::string& name, unsigned reads, unsigned writes,
+    Job fn, bool main_thread = false);
+
+  void run();
+};
+
+}
+
+#endif /* JOBSYSTEM_H */
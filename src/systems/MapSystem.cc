@@ -1,17 +1,32 @@
 #include "MapSystem.h"
 
+#include <algorithm>
 #include <chrono>
 #include <random>
 #include <iostream>
 #include "../Constants.h"
+#include "../Counters.h"
+#include "../Memory.h"
+#include "../Profiler.h"
 
 using namespace std;
 using namespace osg;
 using namespace ld;
 
-MapSystem::MapSystem(std::mt19937& rng_)
-  : rng(rng_)
+MapSystem::MapSystem(std::mt19937& rng_, int master_size_, int rooms_per_floor_)
+  : tiles(),
+    tiles_mutex(),
+    chunk_versions(),
+    rooms_version(0),
+    regions_version(0),
+    master_size(master_size_),
+    rooms_per_floor(rooms_per_floor_),
+    rng(rng_)
 {
+  MEMORY_SCOPE(MEMORY_MAP);
+
+  tiles.reset(new TileGrid);
+
   setup_map();
 
   layout_map();
@@ -22,9 +37,12 @@ MapSystem::MapSystem(std::mt19937& rng_)
 
 void MapSystem::setup_map()
 {
+  PROFILE_SCOPE("MapSystem::setup_map");
+
   for (auto floor = 0; floor < NUM_FLOORS; ++floor)
   {
-    master_rooms[floor].push_back(Room(-8, 10, 16, 16));
+    master_rooms[floor].push_back(
+      Room(-master_size / 2, 10, master_size, master_size));
 
     for (const auto& master : master_rooms[floor])
       seed_rooms(master, floor);
@@ -33,11 +51,15 @@ void MapSystem::setup_map()
       for (auto& room : rooms[floor])
 	extend_room(room, floor);
   }
+
+  ++rooms_version;
 }
 
 
 void MapSystem::layout_map()
 {
+  PROFILE_SCOPE("MapSystem::layout_map");
+
   for (auto floor = 0; floor < NUM_FLOORS; ++floor)
   {
     for (const auto& room : rooms[floor])
@@ -51,7 +73,7 @@ void MapSystem::layout_map()
 
 void MapSystem::seed_rooms(const Room& master, int floor)
 {
-  for (auto room_num = 0; room_num < ROOMS_PER_FLOOR; ++room_num)
+  for (auto room_num = 0; room_num < rooms_per_floor; ++room_num)
   {
     for (auto i = 0; i < 10000; ++i)
     {
@@ -214,8 +236,12 @@ void MapSystem::set_tile(
   double rotation,
   bool solid)
 {
+  lock_guard<mutex> lock(tiles_mutex);
+
   auto& tile = get_tile(x, y, floor);
 
+  ++chunk_versions[floor][get_chunk(x, y)];
+
   tile.position = Vec3(x, y, floor);
   tile.type = type;
   tile.name = name;
@@ -229,8 +255,12 @@ void MapSystem::set_ceil_tile(
   const string& type, const string& name,
   double rotation)
 {
+  lock_guard<mutex> lock(tiles_mutex);
+
   auto& tile = get_tile(x, y, floor);
 
+  ++chunk_versions[floor][get_chunk(x, y)];
+
   tile.position = Vec3(x, y, floor);
   tile.ceil_type = type;
   tile.ceil_name = name;
@@ -243,13 +273,16 @@ Tile& MapSystem::get_tile(int x_, int y_, int floor)
   auto x = x_ + MAP_SIZE / 2;
   auto y = y_ + MAP_SIZE / 2;
 
-  return tiles[floor][x][y];
+  return (*tiles)[floor][x][y];
 }
 
 
-const Tile& MapSystem::get_tile(int x, int y, int floor) const
+const Tile& MapSystem::get_tile(int x_, int y_, int floor) const
 {
-  return get_tile(x, y, floor);
+  auto x = x_ + MAP_SIZE / 2;
+  auto y = y_ + MAP_SIZE / 2;
+
+  return (*tiles)[floor][x][y];
 }
 
 
@@ -262,15 +295,64 @@ Tile& MapSystem::get_tile(double x_, double y_, int floor)
 }
 
 
+int MapSystem::get_chunk(int x, int y)
+{
+  auto cx = (x + MAP_SIZE / 2) / CHUNK_SIZE;
+  auto cy = (y + MAP_SIZE / 2) / CHUNK_SIZE;
+
+  return cx + cy * CHUNKS_PER_SIDE;
+}
+
+
+// Tiles covered by a chunk; chunks on the far edges are clipped to the map
+Rect MapSystem::get_chunk_rect(int chunk)
+{
+  auto x = (chunk % CHUNKS_PER_SIDE) * CHUNK_SIZE - MAP_SIZE / 2;
+  auto y = (chunk / CHUNKS_PER_SIDE) * CHUNK_SIZE - MAP_SIZE / 2;
+  auto w = std::min(CHUNK_SIZE, MAP_SIZE / 2 + 1 - x);
+  auto h = std::min(CHUNK_SIZE, MAP_SIZE / 2 + 1 - y);
+
+  return Rect(x, y, w, h);
+}
+
+
 bool MapSystem::is_solid(double x, double y, int floor) const
 {
-  return get_tile(x, y, floor).solid;
+  return get_tile((int)std::round(x), (int)std::round(y), floor).solid;
+}
+
+
+const Region* MapSystem::find_region(double x_, double y_, int floor) const
+{
+  auto x = (int)std::round(x_);
+  auto y = (int)std::round(y_);
+
+  uint64_t scanned = 0;
+  const Region* found = nullptr;
+
+  for (const auto& region : regions[floor])
+  {
+    ++scanned;
+
+    if (x >= region.x && x < region.x + region.w &&
+	y >= region.y && y < region.y + region.h)
+    {
+      found = &region;
+      break;
+    }
+  }
+
+  Counters::add(COUNTER_REGIONS_SCANNED, scanned);
+
+  return found;
 }
 
 
 void MapSystem::create_region(int x, int y, int w, int h, int floor, UsableObject* object)
 {
   regions[floor].push_back({x, y, w, h, object});
+
+  ++regions_version;
 }
 
 
@@ -311,6 +393,8 @@ bool MapSystem::room_intersects_room(
 bool MapSystem::room_is_clear(
   const Room& modded_room, const Room& original_room, int floor) const
 {
+  Counters::add(COUNTER_ROOM_CLEAR_CALLS);
+
   for (const auto& room : rooms[floor])
   {
     if (original_room == room) continue;
@@ -323,6 +407,8 @@ bool MapSystem::room_is_clear(
 
 bool MapSystem::room_is_clear(const Room& test_room, int floor) const
 {
+  Counters::add(COUNTER_ROOM_CLEAR_CALLS);
+
   for (const auto& room : rooms[floor])
   {
     if (test_room == room) continue;
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <array>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <vector>
 #include "../Constants.h"
@@ -17,11 +19,15 @@ namespace ld
 static constexpr int NUM_CHUNKS = 5;
 static constexpr int CHUNK_SIZE = 34;
 static constexpr int MAP_SIZE = CHUNK_SIZE * NUM_CHUNKS;
+static constexpr int CHUNKS_PER_SIDE = MAP_SIZE / CHUNK_SIZE + 1;
 static constexpr int NUM_FLOORS = 1;
 static constexpr int ROOMS_PER_FLOOR = 8;
+static constexpr int MASTER_ROOM_SIZE = 16;
 static constexpr double TILE_SIZE = 2.0;
 static constexpr double FLOOR_HEIGHT = 4.0;
 
+typedef std::array<std::array<std::array<Tile, MAP_SIZE+1>, MAP_SIZE+1>, NUM_FLOORS> TileGrid;
+
 class MapSystem
 {
   void setup_map();
@@ -42,18 +48,29 @@ class MapSystem
     const Room& room, bool allow_overlap = true) const;
   bool room_intersects_room(
     const Room& r1, const Room& r2, bool allow_overlap = true) const;
-  bool room_is_clear(const Room& test_room, int floor) const;
   bool room_is_clear(const Room& modded_room, const Room& original_room, int floor) const;
 
   std::array<std::vector<Room>, NUM_FLOORS> rooms;
   std::array<std::vector<Room>, NUM_FLOORS> master_rooms;
   std::array<std::vector<Region>, NUM_FLOORS> regions;
-  std::array<std::array<std::array<Tile, MAP_SIZE+1>, MAP_SIZE+1>, NUM_FLOORS> tiles;
+  // Several megabytes, so kept on the heap where it is accounted to the map
+  std::unique_ptr<TileGrid> tiles;
+  // Held by writers, and by readers on threads other than the simulation's
+  mutable std::mutex tiles_mutex;
+
+  std::array<std::array<unsigned, CHUNKS_PER_SIDE * CHUNKS_PER_SIDE>, NUM_FLOORS> chunk_versions;
+  unsigned rooms_version;
+  unsigned regions_version;
+
+  const int master_size;
+  const int rooms_per_floor;
 
   std::mt19937& rng;
 
 public:
-  MapSystem(std::mt19937& rng);
+  MapSystem(
+    std::mt19937& rng,
+    int master_size = MASTER_ROOM_SIZE, int rooms_per_floor = ROOMS_PER_FLOOR);
 
   void set_tile(
     int x, int y, int floor,
@@ -69,9 +86,21 @@ public:
   const Tile& get_tile(int x, int y, int floor) const;
 
   const std::array<std::vector<Room>, NUM_FLOORS>& get_rooms() const { return rooms; }
+  const std::array<std::vector<Room>, NUM_FLOORS>& get_master_rooms() const { return master_rooms; }
   const std::array<std::vector<Region>, NUM_FLOORS>& get_regions() const { return regions; }
 
   bool is_solid(double x, double y, int floor) const;
+  bool room_is_clear(const Room& test_room, int floor) const;
+  const Region* find_region(double x, double y, int floor) const;
+
+  std::mutex& get_tiles_mutex() const { return tiles_mutex; }
+
+  static int get_chunk(int x, int y);
+  static Rect get_chunk_rect(int chunk);
+
+  unsigned get_chunk_version(int chunk, int floor) const { return chunk_versions[floor][chunk]; }
+  unsigned get_rooms_version() const { return rooms_version; }
+  unsigned get_regions_version() const { return regions_version; }
 
   void create_region(int x, int y, int w, int h, int floor, UsableObject* object = nullptr);
 };
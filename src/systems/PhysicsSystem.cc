@@ -5,7 +5,10 @@
 #include <sstream>
 #include <limits>
 #include <algorithm>
+#include "../Counters.h"
 #include "../Debug.h"
+#include "../Memory.h"
+#include "../Profiler.h"
 
 using namespace std;
 using namespace ld;
@@ -13,12 +16,16 @@ using namespace osg;
 
 PhysicsSystem::PhysicsSystem(
   Input& input_,
+  JobSystem& job_system_,
   EntitySystem& entity_system_,
+  AgentSystem& agent_system_,
   MapSystem& map_system_
 )
   : tile_radius(TILE_SIZE / 4),
     input(input_),
     entity_system(entity_system_),
+    job_system(job_system_),
+    agent_system(agent_system_),
     map_system(map_system_)
 {
   printf("Physics System ready\n");
@@ -27,9 +34,16 @@ PhysicsSystem::PhysicsSystem(
 
 void PhysicsSystem::update(double dt)
 {
+  PROFILE_SCOPE("PhysicsSystem::update");
+  MEMORY_SCOPE(MEMORY_PHYSICS);
+
   auto& user = entity_system.get_user("kadijah");
 
   simulate(user, dt);
+
+  job_system.parallel_for(
+    agent_system.get_agents().size(), AGENT_BATCH_SIZE,
+    [this, dt](size_t begin, size_t end) { simulate_agents(begin, end, dt); });
 }
 
 
@@ -64,7 +78,7 @@ void PhysicsSystem::simulate(DynamicEntity& user, double dt)
     user.position += velocity * dt;
   }
 
-  if (user.collision_active) scan_collisions(user);
+  if (user.collision_active) scan_collisions(user.position, USER_RADIUS);
 
   Matrix r, t;
   r.makeRotate(user_heading);
@@ -78,26 +92,63 @@ void PhysicsSystem::simulate(DynamicEntity& user, double dt)
 }
 
 
-void PhysicsSystem::scan_collisions(DynamicEntity& user)
+void PhysicsSystem::simulate_agents(size_t begin, size_t end, double dt)
+{
+  PROFILE_SCOPE("PhysicsSystem::simulate_agents");
+
+  auto& agents = agent_system.get_agents();
+
+  for (auto i = begin; i < end; ++i)
+    simulate(agents[i], dt);
+}
+
+
+void PhysicsSystem::simulate(Agent& agent, double dt)
+{
+  Vec3 steering(agent.steering);
+
+  if (steering.length2() > 1) steering.normalize();
+
+  agent.velocity = steering * agent.speed;
+  agent.position += agent.velocity * dt;
+
+  const double extent = MAP_SIZE / 2 - 2;
+
+  agent.position.x() = std::min(std::max<double>(agent.position.x(), -extent), extent);
+  agent.position.y() = std::min(std::max<double>(agent.position.y(), -extent), extent);
+
+  scan_collisions(agent.position, AGENT_RADIUS);
+
+  if (agent.velocity.length2() > 0)
+    agent.heading = atan2(agent.velocity.x(), -agent.velocity.y());
+}
+
+
+void PhysicsSystem::scan_collisions(Vec3& position, double radius)
 {
-  auto floor = (int)std::floor(user.position.z());
+  auto floor = (int)std::floor(position.z());
 
   if (floor < 0 || floor >= NUM_FLOORS) return;
 
-  auto px = (int)std::round(user.position.x());
-  auto py = (int)std::round(user.position.y());
+  auto px = (int)std::round(position.x());
+  auto py = (int)std::round(position.y());
+
+  uint64_t collisions = 0;
 
   for (auto x = px - 1; x <= px + 1; ++x)
     for (auto y = py - 1; y <= py + 1; ++y)
       if (map_system.get_tile(x, y, floor).solid)
-	resolve_collision(user, x, y);
+	collisions += resolve_collision(position, radius, x, y);
+
+  Counters::add(COUNTER_TILES_PROBED, 9);
+  if (collisions > 0) Counters::add(COUNTER_COLLISIONS_RESOLVED, collisions);
 }
 
 
-void PhysicsSystem::resolve_collision(DynamicEntity& user, int x, int y)
+bool PhysicsSystem::resolve_collision(Vec3& position, double radius, int x, int y)
 {
   Vec2d tile_pos(x, y);
-  Vec2d user_pos(user.position.x(), user.position.y());
+  Vec2d user_pos(position.x(), position.y());
   Vec2d min(x - tile_radius, y - tile_radius);
   Vec2d max(x + tile_radius, y + tile_radius);
   Vec2d nearest(user_pos);
@@ -110,9 +161,13 @@ void PhysicsSystem::resolve_collision(DynamicEntity& user, int x, int y)
 
   Vec2d norm(user_pos - nearest);
   auto dist = norm.normalize();
-  auto depth = USER_RADIUS - dist;
+  auto depth = radius - dist;
+
+  if (depth <= 0) return false;
+
+  position += Vec3d(norm.x(), norm.y(), 0) * depth;
 
-  if (depth > 0) user.position += Vec3d(norm.x(), norm.y(), 0) * depth;
+  return true;
 }
 
 
@@ -3,9 +3,12 @@
 
 #include <osg/Vec2>
 #include <osg/Vec3>
+#include "AgentSystem.h"
 #include "EntitySystem.h"
+#include "JobSystem.h"
 #include "MapSystem.h"
 #include "../Constants.h"
+#include "../components/Agent.h"
 #include "../components/Input.h"
 #include "../components/DynamicEntity.h"
 
@@ -14,9 +17,8 @@ namespace ld
 
 class PhysicsSystem
 {
-  void simulate(DynamicEntity& user, double dt);
-  void scan_collisions(DynamicEntity& user);
-  void resolve_collision(DynamicEntity& user, int x, int y);
+  void simulate_agents(size_t begin, size_t end, double dt);
+  bool resolve_collision(osg::Vec3& position, double radius, int x, int y);
 
   double cosine_interp(double v1, double v2, double t);
   osg::Vec3d cosine_interp(osg::Vec3 v1, osg::Vec3 v2, double t);
@@ -25,15 +27,26 @@ class PhysicsSystem
 
   Input& input;
   EntitySystem& entity_system;
+  JobSystem& job_system;
+  AgentSystem& agent_system;
   MapSystem& map_system;
 
 public:
+  static constexpr unsigned READS = INPUT_DATA | MAP_DATA;
+  static constexpr unsigned WRITES = ENTITY_DATA | AGENT_DATA | TRANSFORM_DATA;
+
   PhysicsSystem(
     Input& input,
+    JobSystem& job_system,
     EntitySystem& entity_system,
+    AgentSystem& agent_system,
     MapSystem& map_system);
 
   void update(double dt);
+
+  void simulate(DynamicEntity& user, double dt);
+  void simulate(Agent& agent, double dt);
+  void scan_collisions(osg::Vec3& position, double radius);
 };
 
 }
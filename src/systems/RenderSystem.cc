@@ -1,38 +1,124 @@
 #include "RenderSystem.h"
 
+#include <cmath>
 #include <iostream>
+#include <osg/GLExtensions>
+#include <osg/Geode>
 #include <osg/Image>
 #include <osg/LightSource>
 #include <osg/MatrixTransform>
 #include <osg/PositionAttitudeTransform>
+#include <osg/ValueObject>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <osgUtil/Optimizer>
+#include "../ChunkReaderWriter.h"
 #include "../Constants.h"
+#include "../Counters.h"
+#include "../Memory.h"
+#include "../Profiler.h"
+#include "../callbacks/LightingCallback.h"
+#include "../callbacks/PortalCallbacks.h"
 #include "../components/Tile.h"
+#include "../visitors/ObjectCountVisitor.h"
 
 using namespace ld;
 using namespace osg;
 
+// Every chunk group carries the map version it was built from, whether the
+// pager or the rebuild thread built it
+static unsigned get_map_version(const Node* chunk_group)
+{
+  unsigned version = 0;
+  chunk_group->getUserValue("map_version", version);
+
+  return version;
+}
+
+
 RenderSystem::RenderSystem(
   osg::ref_ptr<osg::Group> root_,
   EntitySystem& entity_system_, MapSystem& map_system_
 )
   : root(root_),
+    map_group(new Group),
     entity_system(entity_system_),
-    map_system(map_system_)
+    map_system(map_system_),
+    chunk_reader(new ChunkReaderWriter(*this)),
+    asset_pack(new AssetPack),
+    portal_graph(new PortalGraph(map_system_, entity_system_)),
+    chunks_pending(),
+    rebuilding(true),
+    doors_group(new Group),
+    doors_version(entity_system_.get_doors_version())
 {
+  MEMORY_SCOPE(MEMORY_RENDER);
+
   osgDB::Registry::instance()->getDataFilePathList().push_back("media/");
 
+  if (asset_pack->open(ASSET_PACK))
+    osgDB::Registry::instance()->setReadFileCallback(new AssetPackReadCallback(asset_pack));
+  osgDB::Registry::instance()->addReaderWriter(chunk_reader);
+
   setup_materials();
 
   root->addChild(setup_foundation());
 
+  // Chunks and doors are tagged with the cells they can be seen from
+  if (PORTAL_CULLING) map_group->setCullCallback(new PortalGraphCallback(portal_graph));
+  root->addChild(map_group);
+
   build_map();
   build_objects();
 
   user_xforms["kadijah"] = setup_character("kadijah");
   root->addChild(user_xforms["kadijah"]);
 
+  // Equivalent state the model files bring with them is collapsed into
+  // single instances as well
+  osgUtil::Optimizer optimizer;
+  optimizer.optimize(root, osgUtil::Optimizer::SHARE_DUPLICATE_STATE);
+
+  setup_lighting();
+
+  rebuild_thread = std::thread(&RenderSystem::rebuild_chunks, this);
+
+  printf("Render System ready\n");
+}
+
+
+RenderSystem::~RenderSystem()
+{
+  {
+    std::lock_guard<std::mutex> lock(chunks_mutex);
+    rebuilding = false;
+  }
+  rebuild_cv.notify_all();
+
+  rebuild_thread.join();
+
+  osgDB::Registry::instance()->removeReaderWriter(chunk_reader);
+  osgDB::Registry::instance()->setReadFileCallback(nullptr);
+}
+
+
+// The shader path lights every room with its own point light through
+// ClusteredLighting; the fixed function path keeps the single overhead light
+void RenderSystem::setup_lighting()
+{
+  if (SHADER_LIGHTING)
+  {
+    lighting = new ClusteredLighting(map_system);
+
+    root->setCullCallback(new LightingCallback(lighting));
+
+    return;
+  }
+
   auto stateset = root->getOrCreateStateSet();
+
   stateset->setMode(GL_LIGHTING, StateAttribute::ON);
   stateset->setMode(GL_LIGHT0, StateAttribute::ON);
 
@@ -51,21 +137,15 @@ RenderSystem::RenderSystem(
 
   xform->addChild(ls0);
   root->addChild(xform);
-
-  printf("Render System ready\n");
 }
 
 
 osg::Node* RenderSystem::setup_foundation()
 {
   auto group = new Group;
+  group->setStateSet(get_material_state("buildings"));
 
-  auto state_set = group->getOrCreateStateSet();
-  state_set->setTextureAttributeAndModes(
-    0, textures["buildings"],StateAttribute::ON | StateAttribute::OVERRIDE);
-  state_set->setAttribute(materials["buildings"]);
-
-  auto foundation = osgDB::readNodeFile("models/a-foundation.fbx");
+  auto foundation = load_model("models/a-foundation.fbx");
 
   for (int x = -NUM_CHUNKS / 2; x <= NUM_CHUNKS / 2; ++x)
   {
@@ -85,57 +165,137 @@ osg::Node* RenderSystem::setup_foundation()
 
 osg::Node* RenderSystem::setup_test_grid()
 {
-  auto node = osgDB::readNodeFile("models/grid.fbx");
+  return load_model("models/grid.fbx", "buildings");
+}
 
-  auto state_set = node->getOrCreateStateSet();
-  state_set->setTextureAttributeAndModes(
-    0, textures["buildings"],StateAttribute::ON | StateAttribute::OVERRIDE);
-  state_set->setAttribute(materials["buildings"]);
 
-  return node;
+osg::MatrixTransform* RenderSystem::setup_character(const std::string& name)
+{
+  std::vector<CharacterPart> outfit = {
+    {name, name},
+    {"hair", "clothing1"},
+    {"jacket", "clothing1"},
+    {"tanktop", "clothing1"},
+    {"pants", "clothing1"},
+    {"boots", "clothing1"}};
+
+  auto xform = new MatrixTransform;
+  xform->setDataVariance(Object::DYNAMIC);
+  xform->addChild(load_character(outfit));
+
+  return xform;
 }
 
 
-osg::MatrixTransform* RenderSystem::setup_character(const std::string& name)
+// Each outfit is assembled once into a single drawable with its own atlas
+// texture, and shared by every character wearing it. The atlas is built
+// from the source textures, as cooked ones are usually block compressed.
+// The first part's material is used for the whole character.
+osg::Node* RenderSystem::load_character(const std::vector<CharacterPart>& outfit)
 {
-  auto character_group = new Group;
+  std::string key;
+
+  for (const auto& part : outfit)
+    key += (key.empty() ? "" : "+") + part.model + ":" + part.texture;
+
+  auto it = characters.find(key);
+
+  if (it != characters.end()) return it->second.get();
+
+  PROFILE_SCOPE("RenderSystem::load_character");
+
+  CharacterAssembler assembler;
+  std::map<std::string, ref_ptr<Image>> images;
+
+  for (const auto& part : outfit)
+  {
+    auto& image = images[part.texture];
+
+    if (!image) image = osgDB::readImageFile("textures/" + part.texture + ".png");
+
+    assembler.add_part(load_model("models/" + part.model + ".fbx"), image);
+  }
+
+  ref_ptr<Image> atlas;
+  auto geometry = assembler.assemble(atlas);
+
+  if (!geometry)
+  {
+    printf("Could not assemble character %s\n", key.c_str());
+    return nullptr;
+  }
 
-  auto character = osgDB::readNodeFile("models/" + name + ".fbx");
+  auto texture = new Texture2D(atlas.get());
+  texture->setUnRefImageDataAfterApply(true);
 
-  auto state_set = character->getOrCreateStateSet();
+  auto state_set = new StateSet;
   state_set->setTextureAttributeAndModes(
-    0, textures[name], StateAttribute::ON | StateAttribute::OVERRIDE);
-  state_set->setAttribute(materials[name]);
+    0, texture, StateAttribute::ON | StateAttribute::OVERRIDE);
+  state_set->setAttribute(materials[outfit.front().texture]);
+  state_set->setRenderingHint(StateSet::OPAQUE_BIN);
 
-  character_group->addChild(character);
-  character_group->addChild(setup_accessory("hair"));
-  character_group->addChild(setup_accessory("jacket"));
-  character_group->addChild(setup_accessory("tanktop"));
-  character_group->addChild(setup_accessory("pants"));
-  character_group->addChild(setup_accessory("boots"));
+  auto geode = new Geode;
+  geode->setStateSet(state_set);
+  geode->addDrawable(geometry.get());
 
-  auto xform = new MatrixTransform;
-  xform->addChild(character_group);
+  characters[key] = geode;
 
-  return xform;
+  return geode;
 }
 
 
-osg::Node* RenderSystem::setup_accessory(const std::string& name)
+// Each model file is read once and the same node is shared under every
+// transform that places it. A material is applied by parenting the model
+// to a group holding the material's shared state, so all users of a model
+// must agree on it. A model cooked by LastDitchCooker is read in place of
+// its source when present.
+//
+// The cache is shared with the pager and rebuild threads, which only ever
+// read the cached nodes. Files are read outside the lock, so two threads
+// may read the same model at once; the first one cached wins.
+osg::Node* RenderSystem::load_model(const std::string& filename, const std::string& material)
 {
-  auto node = osgDB::readNodeFile("models/" + name + ".fbx");
+  {
+    std::lock_guard<std::mutex> lock(models_mutex);
 
-  auto state_set = node->getOrCreateStateSet();
-  state_set->setTextureAttributeAndModes(
-    0, textures["clothing1"],StateAttribute::ON | StateAttribute::OVERRIDE);
-  state_set->setAttribute(materials["clothing1"]);
+    auto it = models.find(filename);
+
+    if (it != models.end()) return it->second.get();
+  }
 
-  return node;
+  PROFILE_SCOPE("RenderSystem::load_model");
+
+  auto cooked = osgDB::getNameLessExtension(filename) + ".osgb";
+
+  ref_ptr<Node> node = asset_exists(cooked) ?
+    osgDB::readNodeFile(cooked) :
+    osgDB::readNodeFile(filename);
+
+  if (node && !material.empty())
+  {
+    auto group = new Group;
+    group->setStateSet(get_material_state(material));
+    group->addChild(node);
+
+    node = group;
+  }
+
+  std::lock_guard<std::mutex> lock(models_mutex);
+
+  return models.emplace(filename, node).first->second.get();
+}
+
+
+bool RenderSystem::asset_exists(const std::string& filename) const
+{
+  return asset_pack->fileExists(filename) || !osgDB::findDataFile(filename).empty();
 }
 
 
 void RenderSystem::setup_materials()
 {
+  PROFILE_SCOPE("RenderSystem::setup_materials");
+
   setup_material("kadijah");
   setup_material("clothing1");
   setup_material("buildings");
@@ -144,7 +304,7 @@ void RenderSystem::setup_materials()
 
 void RenderSystem::setup_material(const std::string& name)
 {
-  auto image = osgDB::readImageFile("textures/" + name + ".png");
+  auto image = load_texture(name);
 
   textures[name] = new Texture2D;
   textures[name]->setImage(image);
@@ -154,115 +314,452 @@ void RenderSystem::setup_material(const std::string& name)
   materials[name]->setDiffuse(Material::FRONT, Vec4(.2f, .9f, .9f, 1.f));
   materials[name]->setSpecular(Material::FRONT, Vec4(1.f, 1.f, 1.f, 1.f));
   materials[name]->setShininess(Material::FRONT, 96.f);
+
+  auto state_set = new StateSet;
+  state_set->setTextureAttributeAndModes(
+    0, textures[name], StateAttribute::ON | StateAttribute::OVERRIDE);
+  state_set->setAttribute(materials[name]);
+  state_set->setRenderingHint(StateSet::OPAQUE_BIN);
+
+  material_states[name] = state_set;
+}
+
+
+// Prefers the texture cooked by LastDitchCooker, which carries its mip
+// chain and is usually block compressed, so neither decoding nor mipmap
+// generation happens here or at first apply
+osg::Image* RenderSystem::load_texture(const std::string& name)
+{
+  auto cooked = "textures/" + name + ".dds";
+
+  if (asset_exists(cooked))
+  {
+    auto image = osgDB::readImageFile(cooked);
+
+    if (image) return image;
+  }
+
+  return osgDB::readImageFile("textures/" + name + ".png");
+}
+
+
+// Called from the viewer's realize operation, before anything is drawn.
+// Drivers without S3TC get the source textures instead.
+void RenderSystem::check_texture_support(GraphicsContext* context)
+{
+  auto context_id = context->getState()->getContextID();
+
+  if (isGLExtensionSupported(context_id, "GL_EXT_texture_compression_s3tc")) return;
+
+  for (auto& key_value : textures)
+  {
+    auto image = key_value.second->getImage();
+
+    if (image && image->isCompressed())
+    {
+      printf("Texture compression unsupported, using uncompressed %s\n", key_value.first.c_str());
+
+      key_value.second->setImage(osgDB::readImageFile("textures/" + key_value.first + ".png"));
+    }
+  }
+}
+
+
+// Every node drawn with a material points at the same StateSet, so the
+// cull traversal files all of its drawables under one state graph leaf
+// and the draw traversal applies the material once per frame
+StateSet* RenderSystem::get_material_state(const std::string& name)
+{
+  auto it = material_states.find(name);
+
+  if (it == material_states.end())
+  {
+    printf("Unknown material '%s'\n", name.c_str());
+    return nullptr;
+  }
+
+  return it->second.get();
 }
 
 
 void RenderSystem::build_map()
 {
-  for (int floor = 0; floor < NUM_FLOORS; ++floor)
+  PROFILE_SCOPE("RenderSystem::build_map");
+
+  // Chunks are only built once the camera comes within range of them, and
+  // expire again once it has been out of range for a while
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    for (auto chunk = 0; chunk < CHUNKS_PER_SIDE * CHUNKS_PER_SIDE; ++chunk)
+    {
+      auto rect = MapSystem::get_chunk_rect(chunk);
+
+      auto center = Vec3(
+	TILE_SIZE * (rect.x + (rect.w - 1) / 2.0),
+	TILE_SIZE * (rect.y + (rect.h - 1) / 2.0),
+	FLOOR_HEIGHT * (floor + .5));
+      auto radius =
+	TILE_SIZE * std::sqrt(rect.w * rect.w + rect.h * rect.h) / 2.0 + FLOOR_HEIGHT;
+
+      auto lod = new PagedLOD;
+      lod->setCenterMode(LOD::USER_DEFINED_CENTER);
+      lod->setCenter(center);
+      lod->setRadius(radius);
+      lod->setFileName(0, ChunkReaderWriter::get_file_name(chunk, floor));
+      lod->setRange(0, 0.f, FAR_CLIP + radius);
+      lod->setMinimumExpiryTime(0, CHUNK_EXPIRY_TIME);
+
+      // Set here rather than on the chunk group, as attaching the shared
+      // state from a pager thread would race on its parent list
+      lod->setStateSet(get_material_state("buildings"));
+
+      chunk_nodes[floor][chunk] = lod;
+
+      map_group->addChild(lod);
+    }
+  }
+}
+
+
+// Loaded chunks whose tiles changed since they were built are rebuilt off
+// the render thread. The map is skipped for a frame while a writer or a
+// chunk build holds its tiles.
+void RenderSystem::queue_dirty_chunks()
+{
+  std::unique_lock<std::mutex> tiles_lock(map_system.get_tiles_mutex(), std::try_to_lock);
+
+  if (!tiles_lock.owns_lock()) return;
+
+  std::lock_guard<std::mutex> lock(chunks_mutex);
+
+  auto queued = false;
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
   {
-    for (int x = -MAP_SIZE / 2; x <= MAP_SIZE / 2; ++x)
+    for (auto chunk = 0; chunk < CHUNKS_PER_SIDE * CHUNKS_PER_SIDE; ++chunk)
     {
-      for (int y = -MAP_SIZE / 2; y <= MAP_SIZE / 2; ++y)
+      if (chunks_pending[floor][chunk]) continue;
+      if (chunk_nodes[floor][chunk]->getNumChildren() == 0) continue;
+      if (map_system.get_chunk_version(chunk, floor) == get_installed_version(chunk, floor))
+	continue;
+
+      chunks_pending[floor][chunk] = true;
+      rebuild_requests.push_back({chunk, floor});
+
+      queued = true;
+    }
+  }
+
+  if (queued) rebuild_cv.notify_one();
+}
+
+
+void RenderSystem::rebuild_chunks()
+{
+  MEMORY_SCOPE(MEMORY_RENDER);
+
+  std::unique_lock<std::mutex> lock(chunks_mutex);
+
+  while (true)
+  {
+    rebuild_cv.wait(lock, [this]() { return !rebuilding || !rebuild_requests.empty(); });
+
+    if (!rebuilding) return;
+
+    auto request = rebuild_requests.front();
+    rebuild_requests.pop_front();
+
+    lock.unlock();
+
+    auto group = build_chunk(request.first, request.second);
+
+    lock.lock();
+
+    rebuilt_chunks.push_back({request.first, request.second, get_map_version(group), group});
+  }
+}
+
+
+// Replaces each rebuilt chunk's geometry between frames, so a chunk is
+// never drawn half built. A chunk the pager expired in the meantime is
+// simply built again from the current map when it comes back into range,
+// and a rebuild older than what the pager installed since is dropped.
+void RenderSystem::swap_rebuilt_chunks()
+{
+  std::vector<RebuiltChunk> chunks;
+
+  {
+    std::lock_guard<std::mutex> lock(chunks_mutex);
+    chunks.swap(rebuilt_chunks);
+  }
+
+  for (auto& rebuilt : chunks)
+  {
+    auto& lod = chunk_nodes[rebuilt.floor][rebuilt.chunk];
+
+    if (lod->getNumChildren() > 0 &&
+	rebuilt.version > get_installed_version(rebuilt.chunk, rebuilt.floor))
+      lod->setChild(0, rebuilt.group);
+
+    chunks_pending[rebuilt.floor][rebuilt.chunk] = false;
+  }
+}
+
+
+// Only called from the render thread, which is also where the pager merges
+// the chunks it loads
+unsigned RenderSystem::get_installed_version(int chunk, int floor) const
+{
+  const auto& lod = chunk_nodes[floor][chunk];
+
+  return lod->getNumChildren() > 0 ? get_map_version(lod->getChild(0)) : 0;
+}
+
+
+// Copies the geometry of every tile model of a chunk, transformed into
+// place, into new merged arrays. Tiles are grouped by the portal cells they
+// can be seen from, and each group becomes one drawable so it can be culled
+// on its own. The cached models are only ever read, never flattened in
+// place, as other chunks and the doors keep using them.
+osg::ref_ptr<osg::Group> RenderSystem::build_chunk(int chunk, int floor)
+{
+  PROFILE_SCOPE("RenderSystem::build_chunk");
+
+  ref_ptr<Group> group = new Group;
+
+  auto rect = MapSystem::get_chunk_rect(chunk);
+
+  // The tiles are copied out so the map is only locked for the copy, not
+  // while models are read and merged
+  std::vector<Tile> tiles;
+  tiles.reserve(rect.w * rect.h);
+
+  std::unique_lock<std::mutex> lock(map_system.get_tiles_mutex());
+
+  auto version = map_system.get_chunk_version(chunk, floor);
+
+  for (auto x = rect.x; x < rect.x + rect.w; ++x)
+    for (auto y = rect.y; y < rect.y + rect.h; ++y)
+      tiles.push_back(map_system.get_tile(x, y, floor));
+
+  lock.unlock();
+
+  std::map<CellSet, GeometryMerger> cell_mergers;
+
+  uint64_t nodes = 0;
+
+  for (auto x = rect.x; x < rect.x + rect.w; ++x)
+  {
+    for (auto y = rect.y; y < rect.y + rect.h; ++y)
+    {
+      const auto& tile = tiles[(x - rect.x) * rect.h + (y - rect.y)];
+
+      if (tile.name == "" && tile.ceil_name == "") continue;
+
+      auto cells = PORTAL_CULLING ? portal_graph->get_cells(x, y, floor) : CellSet();
+      auto& merger = cell_mergers[cells];
+
+      if (tile.name != "")
+      {
+	merger.add(
+	  load_model("models/" + tile.type + "-" + tile.name + ".fbx"),
+	  tile_matrix(x, y, floor, tile.rotation));
+
+	++nodes;
+      }
+
+      if (tile.ceil_name != "")
       {
-	const auto& tile = map_system.get_tile(x, y, floor);
-
-	if (tile.name != "")
-	{
-	  auto node = osgDB::readNodeFile(
-	    "models/" + tile.type + "-" + tile.name + ".fbx");
-
-	  auto state_set = node->getOrCreateStateSet();
-	  state_set->setTextureAttributeAndModes(
-	    0, textures["buildings"], StateAttribute::ON | StateAttribute::OVERRIDE);
-	  state_set->setAttribute(materials["buildings"]);
-
-	  auto xform = new MatrixTransform;
-
-	  Matrix r, t;
-	  r.makeRotate(inDegrees(tile.rotation), Vec3(0, 0, 1));
-	  t.makeTranslate(
-	    Vec3(
-	      TILE_SIZE * x,
-	      TILE_SIZE * y,
-	      FLOOR_HEIGHT * tile.position.z()));
-
-	  xform->setMatrix(r * t);
-	  xform->addChild(node);
-	  root->addChild(xform);
-	}
-
-	if (tile.ceil_name != "")
-	{
-	  auto node = osgDB::readNodeFile(
-	    "models/" + tile.ceil_type + "-" + tile.ceil_name + ".fbx");
-
-	  auto state_set = node->getOrCreateStateSet();
-	  state_set->setTextureAttributeAndModes(
-	    0, textures["buildings"], StateAttribute::ON | StateAttribute::OVERRIDE);
-	  state_set->setAttribute(materials["buildings"]);
-
-	  auto xform = new MatrixTransform;
-
-	  Matrix r, t;
-	  r.makeRotate(inDegrees(tile.ceil_rotation), Vec3(0, 0, 1));
-	  t.makeTranslate(
-	    Vec3(
-	      TILE_SIZE * x,
-	      TILE_SIZE * y,
-	      FLOOR_HEIGHT * (tile.position.z() + 1)));
-
-	  xform->setMatrix(r * t);
-	  xform->addChild(node);
-	  root->addChild(xform);
-	}
+	merger.add(
+	  load_model("models/" + tile.ceil_type + "-" + tile.ceil_name + ".fbx"),
+	  tile_matrix(x, y, floor + 1, tile.ceil_rotation));
+
+	++nodes;
       }
     }
   }
+
+  Counters::add(COUNTER_NODES_BUILT, nodes);
+
+  for (const auto& key_value : cell_mergers)
+  {
+    if (key_value.second.empty()) continue;
+
+    auto geode = new Geode;
+    geode->addDrawable(key_value.second.get_geometry().get());
+
+    if (!key_value.first.empty())
+      geode->setCullCallback(new CellCullCallback(portal_graph, key_value.first));
+
+    group->addChild(geode);
+  }
+
+  group->setUserValue("map_version", version);
+
+  return group;
+}
+
+
+Matrix RenderSystem::tile_matrix(int x, int y, double z, double rotation) const
+{
+  Matrix r, t;
+  r.makeRotate(inDegrees(rotation), Vec3(0, 0, 1));
+  t.makeTranslate(Vec3(TILE_SIZE * x, TILE_SIZE * y, FLOOR_HEIGHT * z));
+
+  return r * t;
 }
 
 
 void RenderSystem::build_objects()
 {
-  const auto& doors = entity_system.get_doors();
+  PROFILE_SCOPE("RenderSystem::build_objects");
+
+  doors_group->setStateSet(get_material_state("buildings"));
+
+  update_doors(entity_system.get_doors());
+
+  map_group->addChild(doors_group);
+}
+
+
+// Doors are compared against the layout their transforms were built from,
+// and only the transforms of doors that were added, removed or changed are
+// replaced. The models come from the cache, so this stays cheap enough for
+// the render thread.
+void RenderSystem::update_doors(const std::array<std::vector<Door>, NUM_FLOORS>& layout)
+{
+  PROFILE_SCOPE("RenderSystem::update_doors");
 
   for (auto floor = 0; floor < NUM_FLOORS; ++floor)
   {
-    for (const auto& door : doors[floor])
+    const auto& floor_doors = layout[floor];
+    auto& xforms = door_xforms[floor];
+
+    for (size_t i = 0; i < floor_doors.size(); ++i)
+    {
+      const auto& door = floor_doors[i];
+
+      if (i < doors[floor].size())
+      {
+	const auto& built = doors[floor][i];
+
+	auto unchanged =
+	  built.x == door.x && built.y == door.y &&
+	  built.type == door.type && built.name == door.name &&
+	  built.rotation == door.rotation;
+
+	if (unchanged) continue;
+      }
+
+      auto xform = setup_door(door, floor);
+      std::array<Matrix, 2> matrices{
+	{door_matrix(door, floor, false), door_matrix(door, floor, true)}};
+
+      if (i < xforms.size())
+      {
+	doors_group->replaceChild(xforms[i], xform);
+	xforms[i] = xform;
+	door_matrices[floor][i] = matrices;
+      }
+      else
+      {
+	doors_group->addChild(xform);
+	xforms.push_back(xform);
+	door_matrices[floor].push_back(matrices);
+      }
+    }
+
+    while (xforms.size() > floor_doors.size())
     {
-      auto node = osgDB::readNodeFile(
-	"models/" + door.type + "-" + door.name + ".fbx");
-
-      auto state_set = node->getOrCreateStateSet();
-      state_set->setTextureAttributeAndModes(
-	0, textures["buildings"], StateAttribute::ON | StateAttribute::OVERRIDE);
-      state_set->setAttribute(materials["buildings"]);
-
-      auto xform = new MatrixTransform;
-
-      Matrix r, t;
-      r.makeRotate(inDegrees(door.rotation), Vec3(0, 0, 1));
-      t.makeTranslate(
-	Vec3(
-	  TILE_SIZE * door.x,
-	  TILE_SIZE * door.y,
-	  FLOOR_HEIGHT * floor));
-
-      xform->setMatrix(r * t);
-      xform->addChild(node);
-      root->addChild(xform);
+      doors_group->removeChild(xforms.back());
+      xforms.pop_back();
+      door_matrices[floor].pop_back();
     }
+
+    doors[floor] = floor_doors;
   }
+
+  portal_graph->set_doors(layout);
+}
+
+
+osg::MatrixTransform* RenderSystem::setup_door(const Door& door, int floor)
+{
+  auto node = load_model("models/" + door.type + "-" + door.name + ".fbx");
+
+  auto xform = new MatrixTransform;
+  xform->setDataVariance(Object::DYNAMIC);
+  xform->setMatrix(door_matrix(door, floor, false));
+  xform->addChild(node);
+
+  if (PORTAL_CULLING)
+    xform->setCullCallback(
+      new CellCullCallback(portal_graph, portal_graph->get_cells(door.x, door.y, floor)));
+
+  return xform;
 }
 
 
-void RenderSystem::update()
+Matrix RenderSystem::door_matrix(const Door& door, int floor, bool open) const
 {
+  Matrix r, t;
+  r.makeRotate(inDegrees(door.rotation + (open ? 90.0 : 0.0)), Vec3(0, 0, 1));
+  t.makeTranslate(
+    Vec3(
+      TILE_SIZE * door.x,
+      TILE_SIZE * door.y,
+      FLOOR_HEIGHT * floor));
+
+  return r * t;
+}
+
+
+void RenderSystem::update(const Snapshot& snapshot)
+{
+  PROFILE_SCOPE("RenderSystem::update");
+  MEMORY_SCOPE(MEMORY_RENDER);
+
+  swap_rebuilt_chunks();
+  queue_dirty_chunks();
+
+  if (snapshot.doors_version != doors_version)
+  {
+    doors_version = snapshot.doors_version;
+    update_doors(snapshot.door_layout);
+  }
+
   for (auto& key_value : user_xforms)
   {
-    auto username = key_value.first;
-    auto xform = key_value.second;
+    auto user = snapshot.users.find(key_value.first);
+
+    if (user != snapshot.users.end())
+      key_value.second->setMatrix(user->second.matrix);
+  }
+
+  for (auto floor = 0; floor < NUM_FLOORS; ++floor)
+  {
+    const auto& states = snapshot.doors[floor];
+
+    for (size_t i = 0; i < states.size() && i < door_xforms[floor].size(); ++i)
+    {
+      const auto& matrix = door_matrices[floor][i][states[i].open];
 
-    xform->setMatrix(entity_system.get_user(username).matrix);
+      portal_graph->set_door_open(floor, i, states[i].open);
+
+      if (door_xforms[floor][i]->getMatrix() != matrix)
+	door_xforms[floor][i]->setMatrix(matrix);
+    }
   }
 }
+
+
+void RenderSystem::report_objects()
+{
+  ObjectCountVisitor visitor;
+  root->accept(visitor);
+
+  printf("Scene objects: %zu\n", visitor.get_total());
+
+  for (const auto& key_value : visitor.get_counts())
+    printf("%10zu %s\n", key_value.second, key_value.first.c_str());
+}
@@ -1,45 +1,117 @@
 #ifndef RENDERSYSTEM_H
 #define RENDERSYSTEM_H
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <osg/Group>
 #include <osg/Material>
 #include <osg/MatrixTransform>
+#include <osg/PagedLOD>
 #include <osg/Texture2D>
+#include <osgDB/ReaderWriter>
 #include "EntitySystem.h"
 #include "MapSystem.h"
+#include "../AssetPack.h"
+#include "../CharacterAssembler.h"
+#include "../GeometryMerger.h"
+#include "../ClusteredLighting.h"
+#include "../PortalGraph.h"
+#include "../components/Snapshot.h"
 
 namespace ld
 {
 
 class RenderSystem
 {
+  struct RebuiltChunk
+  {
+    int chunk, floor;
+    unsigned version;
+    osg::ref_ptr<osg::Group> group;
+  };
+
   void build_map();
+  void queue_dirty_chunks();
+  void rebuild_chunks();
+  void swap_rebuilt_chunks();
+  unsigned get_installed_version(int chunk, int floor) const;
+  osg::Matrix tile_matrix(int x, int y, double z, double rotation) const;
   void build_objects();
+  void update_doors(const std::array<std::vector<Door>, NUM_FLOORS>& layout);
+  osg::MatrixTransform* setup_door(const Door& door, int floor);
+  void setup_lighting();
   void setup_materials();
   void setup_material(const std::string& name);
+  osg::Image* load_texture(const std::string& name);
+  osg::StateSet* get_material_state(const std::string& name);
+
+  osg::Node* load_model(const std::string& filename, const std::string& material = "");
+  bool asset_exists(const std::string& filename) const;
+
+  osg::Matrix door_matrix(const Door& door, int floor, bool open) const;
 
   osg::Node* setup_foundation();
   osg::Node* setup_test_grid();
-  osg::Node* setup_accessory(const std::string& name);
   osg::MatrixTransform* setup_character(const std::string& name);
+  osg::Node* load_character(const std::vector<CharacterPart>& outfit);
 
   osg::ref_ptr<osg::Group> root;
+  osg::ref_ptr<osg::Group> map_group;
 
   EntitySystem& entity_system;
   MapSystem& map_system;
 
   std::map<std::string, osg::ref_ptr<osg::Texture2D>> textures;
   std::map<std::string, osg::ref_ptr<osg::Material>> materials;
+  std::map<std::string, osg::ref_ptr<osg::StateSet>> material_states;
+  std::map<std::string, osg::ref_ptr<osg::Node>> models;
+  std::map<std::string, osg::ref_ptr<osg::Node>> characters;
+  std::mutex models_mutex;
+
+  osg::ref_ptr<osgDB::ReaderWriter> chunk_reader;
+  osg::ref_ptr<AssetPack> asset_pack;
+  osg::ref_ptr<PortalGraph> portal_graph;
+  osg::ref_ptr<ClusteredLighting> lighting;
+
+  std::array<
+    std::array<osg::ref_ptr<osg::PagedLOD>, CHUNKS_PER_SIDE * CHUNKS_PER_SIDE>,
+    NUM_FLOORS> chunk_nodes;
+
+  // The loaded chunks queued for a rebuild. Requests and results cross to
+  // the rebuild thread under chunks_mutex.
+  std::array<std::array<bool, CHUNKS_PER_SIDE * CHUNKS_PER_SIDE>, NUM_FLOORS> chunks_pending;
+  std::deque<std::pair<int, int>> rebuild_requests;
+  std::vector<RebuiltChunk> rebuilt_chunks;
+  bool rebuilding;
+  std::mutex chunks_mutex;
+  std::condition_variable rebuild_cv;
+  std::thread rebuild_thread;
 
   std::map<std::string, osg::ref_ptr<osg::MatrixTransform>> user_xforms;
 
+  osg::ref_ptr<osg::Group> doors_group;
+  unsigned doors_version;
+  std::array<std::vector<Door>, NUM_FLOORS> doors;
+  std::array<std::vector<osg::ref_ptr<osg::MatrixTransform>>, NUM_FLOORS> door_xforms;
+  std::array<std::vector<std::array<osg::Matrix, 2>>, NUM_FLOORS> door_matrices;
+
 public:
   RenderSystem(
     osg::ref_ptr<osg::Group> root,
     EntitySystem& entity_system, MapSystem& map_system);
+  ~RenderSystem();
+
+  void check_texture_support(osg::GraphicsContext* context);
+
+  void update(const Snapshot& snapshot);
+
+  // Thread safe; called by the DatabasePager as chunks come into range
+  osg::ref_ptr<osg::Group> build_chunk(int chunk, int floor);
 
-  void update();
+  void report_objects();
 };
 
 }
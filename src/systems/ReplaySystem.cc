@@ -0,0 +1,298 @@
+#include "ReplaySystem.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace ld;
+using namespace std;
+
+static const char REPLAY_MAGIC[4] = {'L', 'D', 'R', 'P'};
+
+static uint64_t zigzag(int64_t value)
+{
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+static int64_t unzigzag(uint64_t value)
+{
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+ReplaySystem::ReplaySystem(const string& record_file, const string& replay_file)
+  : file(nullptr),
+    recording(false),
+    playing(false),
+    seed(0),
+    ticks(0),
+    run_length(0),
+    last_buttons(0),
+    last_dt_us(0)
+{
+  if (!replay_file.empty())
+  {
+    file = fopen(replay_file.c_str(), "rb");
+
+    char magic[4];
+    uint32_t version = 0;
+
+    auto valid =
+      file &&
+      fread(magic, sizeof(magic), 1, file) == 1 &&
+      memcmp(magic, REPLAY_MAGIC, sizeof(magic)) == 0 &&
+      fread(&version, sizeof(version), 1, file) == 1 &&
+      version == REPLAY_VERSION &&
+      fread(&seed, sizeof(seed), 1, file) == 1;
+
+    if (valid)
+    {
+      playing = true;
+      printf("Replaying %s with seed %llu\n", replay_file.c_str(), seed);
+    }
+    else
+    {
+      printf("Could not read replay %s\n", replay_file.c_str());
+
+      if (file) fclose(file);
+      file = nullptr;
+    }
+  }
+  else if (!record_file.empty())
+  {
+    file = fopen(record_file.c_str(), "wb");
+
+    if (file)
+      recording = true;
+    else
+      printf("Could not open %s for recording\n", record_file.c_str());
+  }
+
+  printf("Replay System ready\n");
+}
+
+
+ReplaySystem::~ReplaySystem()
+{
+  if (recording)
+  {
+    flush_run();
+    printf("Recorded %llu ticks\n", ticks);
+  }
+
+  if (file) fclose(file);
+}
+
+
+void ReplaySystem::start_recording(unsigned long long seed_)
+{
+  if (!recording) return;
+
+  seed = seed_;
+
+  fwrite(REPLAY_MAGIC, sizeof(REPLAY_MAGIC), 1, file);
+  fwrite(&REPLAY_VERSION, sizeof(REPLAY_VERSION), 1, file);
+  fwrite(&seed, sizeof(seed), 1, file);
+}
+
+
+uint8_t ReplaySystem::pack_buttons(const Input& input)
+{
+  return
+    (input.forward << 0) |
+    (input.backward << 1) |
+    (input.left << 2) |
+    (input.right << 3) |
+    (input.use << 4) |
+    (input.up << 5) |
+    (input.down << 6);
+}
+
+
+void ReplaySystem::unpack_buttons(uint8_t buttons, Input& input)
+{
+  input.forward = buttons & (1 << 0);
+  input.backward = buttons & (1 << 1);
+  input.left = buttons & (1 << 2);
+  input.right = buttons & (1 << 3);
+  input.use = buttons & (1 << 4);
+  input.up = buttons & (1 << 5);
+  input.down = buttons & (1 << 6);
+}
+
+
+void ReplaySystem::write_varint(uint64_t value)
+{
+  uint8_t bytes[10];
+  size_t size = 0;
+
+  do
+  {
+    bytes[size] = value & 0x7f;
+    value >>= 7;
+
+    if (value) bytes[size] |= 0x80;
+
+    ++size;
+  } while (value);
+
+  fwrite(bytes, 1, size, file);
+}
+
+
+bool ReplaySystem::read_varint(uint64_t& value)
+{
+  value = 0;
+
+  for (auto shift = 0; shift < 64; shift += 7)
+  {
+    auto byte = fgetc(file);
+
+    if (byte == EOF) return false;
+
+    value |= (uint64_t)(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80)) return true;
+  }
+
+  return false;
+}
+
+
+void ReplaySystem::flush_run()
+{
+  if (run_length == 0) return;
+
+  fputc(REPLAY_RUN, file);
+  write_varint(run_length);
+
+  run_length = 0;
+}
+
+
+void ReplaySystem::record(const Input& input, double& dt)
+{
+  if (!recording) return;
+
+  // Round dt to whole microseconds so the live run and its replay see
+  // exactly the same value
+  auto dt_us = (int64_t)std::llround(dt * 1e6);
+  dt = dt_us / 1e6;
+
+  auto buttons = pack_buttons(input);
+
+  uint8_t flags = 0;
+  if (buttons != last_buttons) flags |= REPLAY_BUTTONS;
+  if (input.mouse_dx != 0.f || input.mouse_dy != 0.f) flags |= REPLAY_MOUSE;
+  if (dt_us != last_dt_us) flags |= REPLAY_DT;
+
+  ++ticks;
+
+  if (flags == 0)
+  {
+    ++run_length;
+    return;
+  }
+
+  flush_run();
+
+  fputc(flags, file);
+
+  if (flags & REPLAY_BUTTONS) fputc(buttons, file);
+
+  if (flags & REPLAY_MOUSE)
+  {
+    fwrite(&input.mouse_dx, sizeof(input.mouse_dx), 1, file);
+    fwrite(&input.mouse_dy, sizeof(input.mouse_dy), 1, file);
+  }
+
+  if (flags & REPLAY_DT) write_varint(zigzag(dt_us - last_dt_us));
+
+  last_buttons = buttons;
+  last_dt_us = dt_us;
+}
+
+
+bool ReplaySystem::playback(Input& input, double& dt)
+{
+  if (!playing) return false;
+
+  input = Input();
+
+  if (run_length > 0)
+  {
+    --run_length;
+  }
+  else
+  {
+    auto flags = fgetc(file);
+
+    if (flags == EOF)
+    {
+      playing = false;
+      return false;
+    }
+
+    if (flags & REPLAY_RUN)
+    {
+      uint64_t length;
+
+      if (!read_varint(length) || length == 0)
+      {
+	playing = false;
+	return false;
+      }
+
+      run_length = length - 1;
+    }
+    else
+    {
+      if (flags & REPLAY_BUTTONS)
+      {
+	auto buttons = fgetc(file);
+
+	if (buttons == EOF)
+	{
+	  playing = false;
+	  return false;
+	}
+
+	last_buttons = buttons;
+      }
+
+      if (flags & REPLAY_MOUSE)
+      {
+	auto valid =
+	  fread(&input.mouse_dx, sizeof(input.mouse_dx), 1, file) == 1 &&
+	  fread(&input.mouse_dy, sizeof(input.mouse_dy), 1, file) == 1;
+
+	if (!valid)
+	{
+	  playing = false;
+	  return false;
+	}
+      }
+
+      if (flags & REPLAY_DT)
+      {
+	uint64_t delta;
+
+	if (!read_varint(delta))
+	{
+	  playing = false;
+	  return false;
+	}
+
+	last_dt_us += unzigzag(delta);
+      }
+    }
+  }
+
+  unpack_buttons(last_buttons, input);
+  dt = last_dt_us / 1e6;
+
+  ++ticks;
+
+  return true;
+}
@@ -0,0 +1,63 @@
+#ifndef REPLAYSYSTEM_H
+#define REPLAYSYSTEM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "../components/Input.h"
+
+namespace ld
+{
+
+// Replay logs start with a header (magic, version, seed) followed by one
+// record per tick. A record begins with a flags byte saying which fields
+// changed since the previous tick; runs of unchanged ticks collapse into a
+// single RUN record with a repeat count.
+static constexpr uint32_t REPLAY_VERSION = 1;
+
+enum ReplayFlags
+{
+  REPLAY_BUTTONS = 1 << 0,
+  REPLAY_MOUSE = 1 << 1,
+  REPLAY_DT = 1 << 2,
+  REPLAY_RUN = 1 << 7
+};
+
+class ReplaySystem
+{
+  static uint8_t pack_buttons(const Input& input);
+  static void unpack_buttons(uint8_t buttons, Input& input);
+
+  void write_varint(uint64_t value);
+  bool read_varint(uint64_t& value);
+  void flush_run();
+
+  FILE* file;
+  bool recording, playing;
+
+  unsigned long long seed;
+  unsigned long long ticks;
+  unsigned long long run_length;
+
+  uint8_t last_buttons;
+  int64_t last_dt_us;
+
+public:
+  ReplaySystem(const std::string& record_file, const std::string& replay_file);
+  ~ReplaySystem();
+
+  void start_recording(unsigned long long seed);
+
+  void record(const Input& input, double& dt);
+  bool playback(Input& input, double& dt);
+
+  bool is_recording() const { return recording; }
+  bool is_playing() const { return playing; }
+
+  unsigned long long get_seed() const { return seed; }
+  unsigned long long get_ticks() const { return ticks; }
+};
+
+}
+
+#endif /* REPLAYSYSTEM_H */
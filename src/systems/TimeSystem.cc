@@ -5,23 +5,188 @@
 #include <chrono>
 #include <thread>
 #include "../Constants.h"
+#include "../Counters.h"
 
 using namespace ld;
+using namespace std;
+
+void TimingStats::record(double seconds)
+{
+  histogram.record((uint64_t)(seconds * 1e6));
+
+  if (seconds > HITCH_THRESHOLD) ++hitches;
+
+  if (last >= 0.0)
+  {
+    jitter_sum += fabs(seconds - last);
+    ++jitter_count;
+  }
+
+  last = seconds;
+}
+
+
+void TimingStats::clear()
+{
+  histogram.clear();
+  hitches = 0;
+  jitter_sum = 0.0;
+  jitter_count = 0;
+  last = -1.0;
+}
+
+
+TimingReport TimingStats::report() const
+{
+  TimingReport report;
+
+  report.count = histogram.get_count();
+  report.p50 = histogram.percentile(50) / 1000.0;
+  report.p95 = histogram.percentile(95) / 1000.0;
+  report.p99 = histogram.percentile(99) / 1000.0;
+  report.max = histogram.get_max() / 1000.0;
+  report.mean = histogram.get_mean() / 1000.0;
+  report.jitter = jitter_count > 0 ? jitter_sum / jitter_count * 1000.0 : 0.0;
+  report.hitches = hitches;
+
+  return report;
+}
+
 
 TimeSystem::TimeSystem()
   :timer(),
    last_time(timer.tick()),
-   dt(0)
+   next_frame_time(last_time),
+   last_active_time(last_time),
+   window_start_time(last_time),
+   dt(0),
+   idle(false),
+   idle_frame(false),
+   ticks(0),
+   frame_stats(),
+   tick_stats(),
+   frame_window(),
+   tick_window(),
+   frame_report(),
+   tick_report()
 {
   printf("Time System ready\n");
 }
 
 
+TimeSystem::~TimeSystem()
+{
+  report();
+}
+
+
 double TimeSystem::tick()
 {
   auto current = timer.tick();
-  auto dt = timer.delta_s(last_time, current);
+  dt = timer.delta_s(last_time, current);
   last_time = current;
 
+  // The first tick measures startup, not a frame, and a frame paced at the
+  // idle rate measures the planned sleep, so neither counts towards the
+  // frame times or hitches
+  if (ticks++ > 0 && !idle_frame)
+  {
+    frame_stats.record(dt);
+    frame_window.record(dt);
+
+    auto frame_us = (uint64_t)(dt * 1e6);
+
+    Counters::add(COUNTER_FRAME_TIME_US, frame_us);
+    Counters::set(COUNTER_LAST_FRAME_US, frame_us);
+
+    if (dt > HITCH_THRESHOLD) Counters::add(COUNTER_HITCHES);
+  }
+
+  rotate_window(current);
+
   return dt;
 }
+
+
+void TimeSystem::rotate_window(osg::Timer_t now)
+{
+  if (timer.delta_s(window_start_time, now) < STATS_WINDOW) return;
+
+  frame_report = frame_window.report();
+  tick_report = tick_window.report();
+
+  frame_window.clear();
+  tick_window.clear();
+
+  window_start_time = now;
+}
+
+
+void TimeSystem::end_tick()
+{
+  auto work = timer.delta_s(last_time, timer.tick());
+
+  tick_stats.record(work);
+  tick_window.record(work);
+
+  Counters::add(COUNTER_TICKS);
+  Counters::add(COUNTER_TICK_TIME_US, (uint64_t)(work * 1e6));
+}
+
+
+void TimeSystem::wait(bool active)
+{
+  auto now = timer.tick();
+
+  if (active) last_active_time = now;
+
+  idle = timer.delta_s(last_active_time, now) > IDLE_TIMEOUT;
+
+  auto frame_rate = idle ? IDLE_FRAME_RATE : TARGET_FRAME_RATE;
+
+  idle_frame = idle && frame_rate > 0;
+
+  if (frame_rate <= 0)
+  {
+    next_frame_time = now;
+    return;
+  }
+
+  auto period = (osg::Timer_t)(1.0 / (frame_rate * timer.getSecondsPerTick()));
+
+  next_frame_time += period;
+
+  // Drop missed frames instead of bursting to catch up
+  if (next_frame_time + period < now) next_frame_time = now;
+
+  // Sleep through most of the wait, then spin for an accurate wake-up
+  for (; now < next_frame_time; now = timer.tick())
+  {
+    auto remaining = timer.delta_s(now, next_frame_time);
+
+    if (remaining > SPIN_THRESHOLD)
+      this_thread::sleep_for(chrono::duration<double>(remaining - SPIN_THRESHOLD));
+    else
+      this_thread::yield();
+  }
+}
+
+
+void TimeSystem::print_report(const string& name, const TimingReport& report) const
+{
+  printf(
+    "%s: %llu samples, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms, "
+    "mean %.2f ms, jitter %.2f ms, %llu hitches over %.1f ms\n",
+    name.c_str(),
+    report.count,
+    report.p50, report.p95, report.p99, report.max,
+    report.mean, report.jitter,
+    report.hitches, HITCH_THRESHOLD * 1000.0);
+}
+
+
+void TimeSystem::report() const
+{
+  print_report("Frame times", frame_stats.report());
+  print_report("Tick times", tick_stats.report());
+}
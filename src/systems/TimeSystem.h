@@ -1,22 +1,89 @@
 #ifndef TIMESYSTEM_H
 #define TIMESYSTEM_H
 
+#include <string>
 #include <osg/Timer>
+#include "../Histogram.h"
 
 namespace ld
 {
 
+struct TimingReport
+{
+  TimingReport()
+    : count(0),
+      p50(0.0),
+      p95(0.0),
+      p99(0.0),
+      max(0.0),
+      mean(0.0),
+      jitter(0.0),
+      hitches(0)
+  {}
+
+  unsigned long long count;
+  double p50, p95, p99, max, mean;
+  double jitter;
+  unsigned long long hitches;
+};
+
+struct TimingStats
+{
+  TimingStats()
+    : histogram(),
+      hitches(0),
+      jitter_sum(0.0),
+      jitter_count(0),
+      last(-1.0)
+  {}
+
+  void record(double seconds);
+  void clear();
+
+  TimingReport report() const;
+
+  Histogram histogram;
+  unsigned long long hitches;
+  double jitter_sum;
+  unsigned long long jitter_count;
+  double last;
+};
+
 class TimeSystem
 {
+  void rotate_window(osg::Timer_t now);
+  void print_report(const std::string& name, const TimingReport& report) const;
+
   osg::Timer timer;
   osg::Timer_t last_time;
+  osg::Timer_t next_frame_time;
+  osg::Timer_t last_active_time;
+  osg::Timer_t window_start_time;
 
   double dt;
+  bool idle;
+  bool idle_frame;
+
+  unsigned long long ticks;
+
+  TimingStats frame_stats, tick_stats;
+  TimingStats frame_window, tick_window;
+  TimingReport frame_report, tick_report;
 
 public:
   TimeSystem();
+  ~TimeSystem();
 
   double tick();
+  void end_tick();
+  void wait(bool active);
+
+  bool is_idle() const { return idle; }
+
+  const TimingReport& get_frame_report() const { return frame_report; }
+  const TimingReport& get_tick_report() const { return tick_report; }
+
+  void report() const;
 };
 
 }
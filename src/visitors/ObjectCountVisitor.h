@@ -0,0 +1,75 @@
+#ifndef OBJECTCOUNTVISITOR_H
+#define OBJECTCOUNTVISITOR_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <osg/Geode>
+#include <osg/NodeVisitor>
+#include <osg/StateSet>
+
+namespace ld
+{
+
+// Counts the distinct OSG objects in a scene graph by className: nodes,
+// drawables, state sets and their attributes. Shared objects count once.
+class ObjectCountVisitor : public osg::NodeVisitor
+{
+  std::set<const osg::Object*> seen;
+  std::map<std::string, size_t> counts;
+
+  bool count(const osg::Object* object)
+  {
+    if (!object || !seen.insert(object).second) return false;
+
+    ++counts[object->className()];
+
+    return true;
+  }
+
+  void count_state(const osg::StateSet* state_set)
+  {
+    if (!count(state_set)) return;
+
+    for (const auto& attribute : state_set->getAttributeList())
+      count(attribute.second.first.get());
+
+    for (const auto& unit : state_set->getTextureAttributeList())
+      for (const auto& attribute : unit)
+	count(attribute.second.first.get());
+  }
+
+public:
+  ObjectCountVisitor()
+    : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+  {}
+
+  virtual void apply(osg::Node& node)
+  {
+    count(&node);
+    count_state(node.getStateSet());
+
+    traverse(node);
+  }
+
+  virtual void apply(osg::Geode& geode)
+  {
+    count(&geode);
+    count_state(geode.getStateSet());
+
+    for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
+    {
+      auto drawable = geode.getDrawable(i);
+
+      count(drawable);
+      count_state(drawable->getStateSet());
+    }
+  }
+
+  const std::map<std::string, size_t>& get_counts() const { return counts; }
+  size_t get_total() const { return seen.size(); }
+};
+
+}
+
+#endif /* OBJECTCOUNTVISITOR_H */
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <osg/Image>
+#include <osg/Texture>
+#include <osgDB/FileNameUtils>
+#include <osgDB/ImageProcessor>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <osgDB/WriteFile>
+#include <osgUtil/Optimizer>
+
+using namespace osg;
+using namespace std;
+
+// Box filters an 8 bit per channel image down to 1x1 and stores the whole
+// chain in the image, for when no image processor plugin is available
+static void generate_mipmaps(Image& image)
+{
+  auto components = Image::computeNumComponents(image.getPixelFormat());
+
+  std::vector<unsigned char> chain(image.data(), image.data() + image.getImageSizeInBytes());
+  Image::MipmapDataType offsets;
+
+  auto w = image.s();
+  auto h = image.t();
+  size_t previous = 0;
+
+  while (w > 1 || h > 1)
+  {
+    auto next_w = std::max(w / 2, 1);
+    auto next_h = std::max(h / 2, 1);
+
+    offsets.push_back(chain.size());
+    chain.resize(chain.size() + next_w * next_h * components);
+
+    auto source = chain.data() + previous;
+    auto target = chain.data() + offsets.back();
+
+    for (auto y = 0; y < next_h; ++y)
+    {
+      for (auto x = 0; x < next_w; ++x)
+      {
+	auto x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+	auto y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+
+	for (unsigned c = 0; c < components; ++c)
+	{
+	  auto sum =
+	    source[(y0 * w + x0) * components + c] +
+	    source[(y0 * w + x1) * components + c] +
+	    source[(y1 * w + x0) * components + c] +
+	    source[(y1 * w + x1) * components + c];
+
+	  target[(y * next_w + x) * components + c] = (sum + 2) / 4;
+	}
+      }
+    }
+
+    previous = offsets.back();
+    w = next_w;
+    h = next_h;
+  }
+
+  auto data = new unsigned char[chain.size()];
+  memcpy(data, chain.data(), chain.size());
+
+  image.setImage(
+    image.s(), image.t(), 1,
+    image.getInternalTextureFormat(), image.getPixelFormat(), image.getDataType(),
+    data, Image::USE_NEW_DELETE);
+  image.setMipmapLevels(offsets);
+}
+
+
+// Textures are stored with their full mip chain, block compressed when an
+// image processor (the nvtt plugin) is available, and otherwise
+// uncompressed so the runtime still skips decoding and mip generation
+static int cook_texture(const string& input, const string& output)
+{
+  ref_ptr<Image> image = osgDB::readImageFile(input);
+
+  if (!image)
+  {
+    fprintf(stderr, "Could not read %s\n", input.c_str());
+    return 1;
+  }
+
+  image->ensureValidSizeForTexturing(4096);
+
+  auto processor = osgDB::Registry::instance()->getImageProcessor();
+
+  if (processor)
+  {
+    auto format = image->isImageTranslucent() ?
+      Texture::USE_S3TC_DXT5_COMPRESSION :
+      Texture::USE_S3TC_DXT1_COMPRESSION;
+
+    processor->compress(
+      *image, format, true, true,
+      osgDB::ImageProcessor::USE_CPU, osgDB::ImageProcessor::PRODUCTION);
+  }
+  else
+  {
+    printf("No image processor available, %s is left uncompressed\n", output.c_str());
+
+    generate_mipmaps(*image);
+  }
+
+  if (!osgDB::writeImageFile(*image, output))
+  {
+    fprintf(stderr, "Could not write %s\n", output.c_str());
+    return 1;
+  }
+
+  printf("Cooked %s\n", output.c_str());
+
+  return 0;
+}
+
+
+// Models are optimized the way they would be at runtime, their meshes
+// indexed and reordered for the post- and pre-transform vertex caches, and
+// their bounds stored before being written in the native binary format
+static int cook_model(const string& input, const string& output)
+{
+  ref_ptr<Node> node = osgDB::readNodeFile(input);
+
+  if (!node)
+  {
+    fprintf(stderr, "Could not read %s\n", input.c_str());
+    return 1;
+  }
+
+  osgUtil::Optimizer optimizer;
+  optimizer.optimize(node, osgUtil::Optimizer::DEFAULT_OPTIMIZATIONS);
+
+  // Indexing has to run first: the vertex cache passes only reorder
+  // indexed triangles
+  optimizer.optimize(
+    node,
+    osgUtil::Optimizer::INDEX_MESH |
+    osgUtil::Optimizer::VERTEX_POSTTRANSFORM |
+    osgUtil::Optimizer::VERTEX_PRETRANSFORM);
+
+  // Bounds are left out: OSG still computes them from the vertices at load
+  // time, whatever initial bound the file carries
+
+  // Textures are assigned by RenderSystem, so any the model refers to are
+  // kept as references rather than embedded
+  ref_ptr<osgDB::Options> options = new osgDB::Options("WriteImageHint=UseExternal");
+
+  if (!osgDB::writeNodeFile(*node, output, options))
+  {
+    fprintf(stderr, "Could not write %s\n", output.c_str());
+    return 1;
+  }
+
+  printf("Cooked %s\n", output.c_str());
+
+  return 0;
+}
+
+
+// Converts a model to .osgb, or a texture to .dds, at build time
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    fprintf(stderr, "Usage: %s <model|texture> <output.osgb|output.dds>\n", argv[0]);
+    return 1;
+  }
+
+  string input = argv[1];
+  string output = argv[2];
+
+  if (osgDB::getLowerCaseFileExtension(output) == "dds")
+    return cook_texture(input, output);
+
+  return cook_model(input, output);
+}
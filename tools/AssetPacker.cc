@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../src/AssetPack.h"
+
+using namespace ld;
+using namespace std;
+
+// Source formats that only matter to artists and are left out of packs
+static const vector<string> SOURCE_EXTENSIONS = {".fbx", ".xcf"};
+
+struct PackFile
+{
+  string name;
+  string path;
+  uint64_t size;
+};
+
+static bool is_source(const string& name)
+{
+  for (const auto& extension : SOURCE_EXTENSIONS)
+  {
+    if (name.size() >= extension.size() &&
+	name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+static void collect(const string& path, const string& name, vector<PackFile>& files)
+{
+  auto dir = opendir(path.c_str());
+
+  if (!dir)
+  {
+    fprintf(stderr, "Could not open %s\n", path.c_str());
+    return;
+  }
+
+  while (auto entry = readdir(dir))
+  {
+    string child = entry->d_name;
+
+    if (child == "." || child == "..") continue;
+
+    auto child_path = path + "/" + child;
+    auto child_name = name + "/" + child;
+
+    struct stat info;
+
+    if (stat(child_path.c_str(), &info) != 0) continue;
+
+    if (S_ISDIR(info.st_mode))
+      collect(child_path, child_name, files);
+    else if (S_ISREG(info.st_mode) && !is_source(child))
+      files.push_back({child_name, child_path, (uint64_t)info.st_size});
+  }
+
+  closedir(dir);
+}
+
+
+static uint64_t align(uint64_t offset)
+{
+  return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+}
+
+
+// Packs the given directories into a single file RenderSystem maps at
+// startup. Each directory's files are named relative to its parent, so
+// "media/models" contributes "models/a-wall.osgb".
+int main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <output.ldpk> <directory>...\n", argv[0]);
+    return 1;
+  }
+
+  vector<PackFile> files;
+
+  for (auto i = 2; i < argc; ++i)
+  {
+    string path = argv[i];
+
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+
+    auto slash = path.find_last_of('/');
+
+    collect(path, slash == string::npos ? path : path.substr(slash + 1), files);
+  }
+
+  sort(
+    files.begin(), files.end(),
+    [](const PackFile& a, const PackFile& b) { return a.name < b.name; });
+
+  PackHeader header;
+  memcpy(header.magic, "LDPK", sizeof(header.magic));
+  header.version = PACK_VERSION;
+  header.num_entries = files.size();
+  header.names_size = 0;
+
+  vector<PackEntry> entries(files.size());
+
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    entries[i].name_offset = header.names_size;
+    entries[i].name_size = files[i].name.size();
+
+    header.names_size += files[i].name.size();
+  }
+
+  auto offset = align(
+    sizeof(PackHeader) + entries.size() * sizeof(PackEntry) + header.names_size);
+
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    entries[i].offset = offset;
+    entries[i].size = files[i].size;
+
+    offset = align(offset + files[i].size);
+  }
+
+  auto output = fopen(argv[1], "wb");
+
+  if (!output)
+  {
+    fprintf(stderr, "Could not open %s\n", argv[1]);
+    return 1;
+  }
+
+  fwrite(&header, sizeof(header), 1, output);
+  fwrite(entries.data(), sizeof(PackEntry), entries.size(), output);
+
+  for (const auto& file : files)
+    fwrite(file.name.data(), 1, file.name.size(), output);
+
+  vector<char> buffer;
+
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    auto input = fopen(files[i].path.c_str(), "rb");
+
+    buffer.resize(files[i].size);
+
+    if (!input || fread(buffer.data(), 1, buffer.size(), input) != buffer.size())
+    {
+      fprintf(stderr, "Could not read %s\n", files[i].path.c_str());
+
+      if (input) fclose(input);
+      fclose(output);
+      remove(argv[1]);
+
+      return 1;
+    }
+
+    fclose(input);
+
+    fseek(output, entries[i].offset, SEEK_SET);
+    fwrite(buffer.data(), 1, buffer.size(), output);
+  }
+
+  fclose(output);
+
+  printf("Packed %zu files into %s\n", files.size(), argv[1]);
+
+  return 0;
+}
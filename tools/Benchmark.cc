@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/Constants.h"
+#include "../src/components/Input.h"
+#include "../src/systems/JobSystem.h"
+#include "../src/systems/MapSystem.h"
+#include "../src/systems/EntitySystem.h"
+#include "../src/systems/AgentSystem.h"
+#include "../src/systems/PhysicsSystem.h"
+
+using namespace ld;
+using namespace osg;
+using namespace std;
+
+// Benchmark names are part of the output format: results are compared by
+// name from release to release, so existing names should not change.
+struct Result
+{
+  string name;
+  unsigned long long iterations;
+  double seconds;
+};
+
+static vector<Result> results;
+
+static volatile unsigned long long sink;
+
+static double now()
+{
+  return chrono::duration<double>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Runs fn in growing batches until min_time has elapsed. fn performs one
+// operation per call.
+static void run(const string& name, double min_time, const function<void()>& fn)
+{
+  unsigned long long iterations = 0;
+  unsigned long long batch = 1;
+
+  auto start = now();
+  auto elapsed = 0.0;
+
+  while (elapsed < min_time)
+  {
+    for (unsigned long long i = 0; i < batch; ++i)
+      fn();
+
+    iterations += batch;
+    elapsed = now() - start;
+
+    if (batch < (1ull << 20)) batch *= 2;
+  }
+
+  results.push_back({name, iterations, elapsed});
+
+  fprintf(
+    stderr, "%-48s %12.1f ns/op\n",
+    name.c_str(), elapsed * 1e9 / iterations);
+}
+
+
+static void bench_map_generation(mt19937& rng)
+{
+  const int sizes[] = {16, 32, 64};
+  const int room_counts[] = {4, 8, 16};
+
+  for (auto size : sizes)
+  {
+    for (auto rooms : room_counts)
+    {
+      auto name =
+	"map/generate/size_" + to_string(size) + "/rooms_" + to_string(rooms);
+
+      run(name, .5, [&]()
+      {
+	unique_ptr<MapSystem> map(new MapSystem(rng, size, rooms));
+	sink += map->get_rooms()[0].size();
+      });
+    }
+  }
+}
+
+
+static void bench_map_queries(MapSystem& map_system, EntitySystem& entity_system)
+{
+  const auto& rooms = map_system.get_rooms()[0];
+
+  size_t i = 0;
+
+  run("map/room_is_clear", .5, [&]()
+  {
+    const auto& room = rooms[i++ % rooms.size()];
+    Room test_room(room.x + 1, room.y + 1, room.w, room.h);
+
+    sink += map_system.room_is_clear(test_room, 0);
+  });
+
+  const auto& doors = entity_system.get_doors()[0];
+
+  run("entity/find_door", .5, [&]()
+  {
+    if (doors.empty()) return;
+
+    const auto& door = doors[i++ % doors.size()];
+
+    sink += entity_system.find_door(door.x, door.y, 0) != nullptr;
+  });
+
+  const auto& regions = map_system.get_regions()[0];
+
+  run("map/find_region", .5, [&]()
+  {
+    if (regions.empty()) return;
+
+    const auto& region = regions[i++ % regions.size()];
+
+    sink += map_system.find_region(region.x, region.y, 0) != nullptr;
+  });
+}
+
+
+static void bench_physics(
+  PhysicsSystem& physics_system, EntitySystem& entity_system, AgentSystem& agent_system,
+  Input& input)
+{
+  const auto start = entity_system.get_user("kadijah");
+
+  input.forward = true;
+
+  // Copied once, as the name and xform would make a copy per run cost more
+  // than the step; simulate only moves the user and rewrites its matrix
+  auto user = start;
+
+  run("physics/simulate/user", .5, [&]()
+  {
+    user.position = start.position;
+    user.inactive_time = start.inactive_time;
+
+    physics_system.simulate(user, FIXED_TIMESTEP);
+    sink += user.position.x() > 0;
+  });
+
+  input.forward = false;
+
+  auto agents = agent_system.get_agents();
+
+  if (agents.empty()) return;
+
+  size_t i = 0;
+
+  run("physics/simulate/agent", .5, [&]()
+  {
+    auto agent = agents[i++ % agents.size()];
+
+    physics_system.simulate(agent, FIXED_TIMESTEP);
+    sink += agent.position.x() > 0;
+  });
+
+  run("physics/scan_collisions", .5, [&]()
+  {
+    auto position = agents[i++ % agents.size()].position;
+
+    physics_system.scan_collisions(position, AGENT_RADIUS);
+    sink += position.x() > 0;
+  });
+}
+
+
+static void bench_ticks(
+  JobSystem& job_system, EntitySystem& entity_system, AgentSystem& agent_system,
+  PhysicsSystem& physics_system)
+{
+  TaskGraph frame_graph(job_system);
+
+  frame_graph.add(
+    "entities", EntitySystem::READS, EntitySystem::WRITES,
+    [&]() { entity_system.update(); });
+
+  frame_graph.add(
+    "agents", AgentSystem::READS, AgentSystem::WRITES,
+    [&]() { agent_system.update(); });
+
+  frame_graph.add(
+    "physics", PhysicsSystem::READS, PhysicsSystem::WRITES,
+    [&]() { physics_system.update(FIXED_TIMESTEP); });
+
+  run("headless/tick", 2.0, [&]() { frame_graph.run(); });
+}
+
+
+static void write_json(const string& filename, unsigned long long seed)
+{
+  auto file = fopen(filename.c_str(), "w");
+
+  if (!file)
+  {
+    fprintf(stderr, "Could not open %s\n", filename.c_str());
+    return;
+  }
+
+  fprintf(file, "{\n  \"seed\": %llu,\n  \"benchmarks\": [\n", seed);
+
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const auto& result = results[i];
+    auto ns_per_op = result.seconds * 1e9 / result.iterations;
+    auto ops_per_s = result.seconds > 0 ? result.iterations / result.seconds : 0.0;
+
+    fprintf(
+      file,
+      "    {\"name\": \"%s\", \"iterations\": %llu, "
+      "\"ns_per_op\": %.3f, \"ops_per_s\": %.3f}%s\n",
+      result.name.c_str(), result.iterations, ns_per_op, ops_per_s,
+      i + 1 < results.size() ? "," : "");
+  }
+
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+}
+
+
+int main(int argc, char** argv)
+{
+  string output = argc > 1 ? argv[1] : "benchmark.json";
+
+  const unsigned long long seed = SEED > 0 ? SEED : 1;
+
+  mt19937 rng(seed);
+  Input input;
+
+  JobSystem job_system;
+  unique_ptr<MapSystem> map_system(new MapSystem(rng));
+  EntitySystem entity_system(rng, input, *map_system);
+  AgentSystem agent_system(rng, job_system, *map_system);
+  PhysicsSystem physics_system(
+    input, job_system, entity_system, agent_system, *map_system);
+
+  bench_map_generation(rng);
+  bench_map_queries(*map_system, entity_system);
+  bench_physics(physics_system, entity_system, agent_system, input);
+  bench_ticks(job_system, entity_system, agent_system, physics_system);
+
+  write_json(output, seed);
+
+  printf("Wrote %s\n", output.c_str());
+}
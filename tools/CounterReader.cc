@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../src/Counters.h"
+
+using namespace ld;
+using namespace std;
+
+// Samples the counters a running LastDitch exports and prints each total
+// with its rate over the last interval. The counter list, names and slot
+// layout come from the segment's header rather than this build's enum, so
+// the reader keeps working when counters are added.
+int main(int argc, char** argv)
+{
+  string name = argc > 1 ? argv[1] : "/lastditch";
+  auto interval = argc > 2 ? atof(argv[2]) : 1.0;
+
+  auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+  if (fd < 0)
+  {
+    fprintf(stderr, "Could not open shared memory %s\n", name.c_str());
+    return 1;
+  }
+
+  struct stat info;
+  fstat(fd, &info);
+
+  auto size = (size_t)info.st_size;
+  auto segment = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (segment == MAP_FAILED || size < sizeof(CounterHeader))
+  {
+    fprintf(stderr, "Could not map shared memory %s\n", name.c_str());
+    return 1;
+  }
+
+  auto header = static_cast<const CounterHeader*>(segment);
+
+  auto header_size = (size_t)header->header_size;
+  auto num_counters = (size_t)header->num_counters;
+
+  auto valid =
+    strncmp(header->magic, "LDCNTRS", sizeof(header->magic)) == 0 &&
+    header->version == COUNTERS_VERSION &&
+    header_size + (size_t)header->num_slots * header->slot_size <= size &&
+    header->names_offset + num_counters * COUNTER_NAME_SIZE <= header_size &&
+    header->kinds_offset + num_counters <= header_size;
+
+  if (!valid)
+  {
+    fprintf(stderr, "%s is not a counter segment this reader understands\n", name.c_str());
+    return 1;
+  }
+
+  auto names = static_cast<const char*>(segment) + header->names_offset;
+  auto kinds = static_cast<const uint8_t*>(segment) + header->kinds_offset;
+
+  printf("Reading %zu counters from pid %llu\n", num_counters, (unsigned long long)header->pid);
+
+  vector<uint64_t> last(num_counters, 0);
+  auto first = true;
+
+  while (strncmp(header->magic, "LDCNTRS", sizeof(header->magic)) == 0)
+  {
+    auto used_slots = header->used_slots.load(memory_order_acquire);
+
+    printf("\n");
+
+    for (size_t i = 0; i < num_counters; ++i)
+    {
+      uint64_t value = 0;
+
+      for (uint32_t slot = 0; slot < used_slots; ++slot)
+      {
+	auto base =
+	  static_cast<const char*>(segment) + header->header_size + slot * header->slot_size;
+	auto counter = reinterpret_cast<const atomic<uint64_t>*>(base) + i;
+
+	value += counter->load(memory_order_relaxed);
+      }
+
+      auto counter_name = names + i * COUNTER_NAME_SIZE;
+
+      if (kinds[i] == COUNTER_KIND_GAUGE || first)
+	printf("%-32s %16llu\n", counter_name, (unsigned long long)value);
+      else
+	printf(
+	  "%-32s %16llu %14.1f/s\n",
+	  counter_name, (unsigned long long)value, (value - last[i]) / interval);
+
+      last[i] = value;
+    }
+
+    first = false;
+
+    this_thread::sleep_for(chrono::duration<double>(interval));
+  }
+
+  printf("\n%s closed\n", name.c_str());
+
+  munmap(segment, size);
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "../src/Log.h"
+
+using namespace ld;
+using namespace std;
+
+// Renders a binary log written by Logger as text, one line per message,
+// ordered by timestamp across threads.
+struct Site
+{
+  int level;
+  int line;
+  string file;
+  string format;
+};
+
+struct Message
+{
+  uint64_t timestamp;
+  uint32_t thread_id;
+  uint64_t site_id;
+  string args;
+};
+
+static bool read_string(FILE* file, string& value)
+{
+  uint32_t size;
+
+  if (fread(&size, sizeof(size), 1, file) != 1) return false;
+
+  value.resize(size);
+
+  return size == 0 || fread(&value[0], 1, size, file) == size;
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s log-file [min-level]\n", argv[0]);
+    return 1;
+  }
+
+  auto file = fopen(argv[1], "rb");
+  auto min_level = argc > 2 ? Logger::parse_level(argv[2]) : LOG_LEVEL_DEBUG;
+
+  char magic[4];
+  uint32_t version = 0;
+
+  auto valid =
+    file &&
+    fread(magic, sizeof(magic), 1, file) == 1 &&
+    memcmp(magic, "LDLG", sizeof(magic)) == 0 &&
+    fread(&version, sizeof(version), 1, file) == 1 &&
+    version == LOG_VERSION;
+
+  if (!valid)
+  {
+    fprintf(stderr, "Could not read log %s\n", argv[1]);
+    return 1;
+  }
+
+  map<uint64_t, Site> sites;
+  vector<Message> messages;
+
+  for (int type; (type = fgetc(file)) != EOF;)
+  {
+    if (type == LOG_ENTRY_SITE)
+    {
+      uint64_t site_id;
+      uint8_t level;
+      int32_t line;
+      Site site;
+
+      auto ok =
+	fread(&site_id, sizeof(site_id), 1, file) == 1 &&
+	fread(&level, sizeof(level), 1, file) == 1 &&
+	fread(&line, sizeof(line), 1, file) == 1 &&
+	read_string(file, site.file) &&
+	read_string(file, site.format);
+
+      if (!ok) break;
+
+      site.level = level;
+      site.line = line;
+      sites[site_id] = site;
+    }
+    else if (type == LOG_ENTRY_MESSAGE)
+    {
+      Message message;
+
+      auto ok =
+	fread(&message.timestamp, sizeof(message.timestamp), 1, file) == 1 &&
+	fread(&message.thread_id, sizeof(message.thread_id), 1, file) == 1 &&
+	fread(&message.site_id, sizeof(message.site_id), 1, file) == 1 &&
+	read_string(file, message.args);
+
+      if (!ok) break;
+
+      messages.push_back(message);
+    }
+    else
+    {
+      fprintf(stderr, "Corrupt entry in %s\n", argv[1]);
+      break;
+    }
+  }
+
+  fclose(file);
+
+  stable_sort(
+    messages.begin(), messages.end(),
+    [](const Message& a, const Message& b) { return a.timestamp < b.timestamp; });
+
+  auto start = messages.empty() ? 0 : messages.front().timestamp;
+
+  for (const auto& message : messages)
+  {
+    auto it = sites.find(message.site_id);
+
+    if (it == sites.end()) continue;
+
+    const auto& site = it->second;
+
+    if (site.level < min_level) continue;
+
+    auto text = Logger::format(site.format.c_str(), message.args.data(), message.args.size());
+
+    if (!text.empty() && text.back() == '\n') text.pop_back();
+
+    printf(
+      "%12.6f [%u] %-7s %s:%d %s\n",
+      (message.timestamp - start) / 1e9,
+      message.thread_id,
+      Logger::get_level_name(site.level),
+      site.file.c_str(), site.line,
+      text.c_str());
+  }
+}
@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <osg/GL>
+#include <osg/GraphicsContext>
+#include <osg/Stats>
+#include <osg/Viewport>
+#include <osgDB/DatabasePager>
+#include <osgViewer/Viewer>
+#include "../src/Constants.h"
+#include "../src/components/Input.h"
+#include "../src/systems/MapSystem.h"
+#include "../src/systems/EntitySystem.h"
+#include "../src/systems/RenderSystem.h"
+#include "../src/visitors/ObjectCountVisitor.h"
+
+using namespace ld;
+using namespace osg;
+using namespace std;
+
+// Renders fixed camera paths through the generated map into a pbuffer and
+// reports per-frame timings and scene statistics. On machines without a
+// GPU, run it under Xvfb with LIBGL_ALWAYS_SOFTWARE=1 so Mesa's llvmpipe
+// provides the context; the renderer in use is recorded with the results.
+//
+// As with LastDitchBenchmark, path and metric names are part of the output
+// format and should not change.
+static constexpr int WIDTH = 1280;
+static constexpr int HEIGHT = 720;
+static constexpr int STATS_LATENCY_FRAMES = 8;
+
+struct CameraPath
+{
+  string name;
+  function<void(double t, Vec3& eye, Vec3& center)> at;
+};
+
+struct Metric
+{
+  string name;
+  string attribute;
+  double scale;
+};
+
+// Camera stats attributes recorded by osgViewer's Renderer; times are
+// reported in seconds
+static const vector<Metric> METRICS =
+{
+  {"cull_ms", "Cull traversal time taken", 1e3},
+  {"draw_ms", "Draw traversal time taken", 1e3},
+  {"gpu_ms", "GPU draw time taken", 1e3},
+  {"drawables", "Visible number of drawables", 1},
+  {"state_graphs", "Number of StateGraphs", 1},
+  {"vertices", "Visible vertex count", 1}
+};
+
+struct Summary
+{
+  size_t count;
+  double mean;
+  double p50;
+  double p95;
+  double max;
+};
+
+struct PathResult
+{
+  string name;
+  int frames;
+  size_t objects;
+  vector<pair<string, Summary>> summaries;
+};
+
+static vector<PathResult> results;
+
+static string renderer = "unknown";
+
+class RendererOperation : public GraphicsOperation
+{
+public:
+  RendererOperation()
+    : GraphicsOperation("RendererOperation", false)
+  {}
+
+  virtual void operator()(GraphicsContext*)
+  {
+    auto name = glGetString(GL_RENDERER);
+
+    if (name) renderer = reinterpret_cast<const char*>(name);
+  }
+};
+
+
+static double now()
+{
+  return chrono::duration<double>(
+    chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static Summary summarize(vector<double> values)
+{
+  Summary summary = {values.size(), 0, 0, 0, 0};
+
+  if (values.empty()) return summary;
+
+  sort(values.begin(), values.end());
+
+  for (auto value : values)
+    summary.mean += value;
+
+  summary.mean /= values.size();
+  summary.p50 = values[values.size() / 2];
+  summary.p95 = values[min(values.size() - 1, values.size() * 95 / 100)];
+  summary.max = values.back();
+
+  return summary;
+}
+
+
+// Paths are in tile units, like user positions, and scaled to the world
+// the same way CameraSystem does
+static vector<CameraPath> camera_paths()
+{
+  const double extent = MAP_SIZE / 2 - 2;
+
+  auto to_world = [](const Vec3& position)
+  {
+    return Vec3(
+      TILE_SIZE * position.x(), TILE_SIZE * position.y(), FLOOR_HEIGHT * position.z());
+  };
+
+  return {
+    {"render/walk", [=](double t, Vec3& eye, Vec3& center)
+     {
+       auto x = -extent + 2 * extent * t;
+
+       eye = to_world(Vec3(x, 0, CAMERA_HEIGHT));
+       center = to_world(Vec3(x + 1, 0, CAMERA_HEIGHT));
+     }},
+    {"render/orbit", [=](double t, Vec3& eye, Vec3& center)
+     {
+       auto angle = 2 * PI * t;
+
+       eye = to_world(Vec3(extent / 2 * cos(angle), extent / 2 * sin(angle), 3));
+       center = to_world(Vec3(0, 0, 0));
+     }}
+  };
+}
+
+
+static ref_ptr<GraphicsContext> create_context()
+{
+  ref_ptr<GraphicsContext::Traits> traits = new GraphicsContext::Traits;
+  traits->x = 0;
+  traits->y = 0;
+  traits->width = WIDTH;
+  traits->height = HEIGHT;
+  traits->windowDecoration = false;
+  traits->doubleBuffer = false;
+  traits->pbuffer = true;
+
+  return GraphicsContext::createGraphicsContext(traits);
+}
+
+
+static void place_camera(osgViewer::Viewer& viewer, const CameraPath& path, double t)
+{
+  Vec3 eye, center;
+  path.at(t, eye, center);
+
+  viewer.getCamera()->setViewMatrixAsLookAt(eye, center, Vec3(0, 0, 1));
+}
+
+
+static void bench_path(osgViewer::Viewer& viewer, Group* root, const CameraPath& path, int frames)
+{
+  auto pager = viewer.getDatabasePager();
+
+  // The first pass pages in every chunk the path sees, so the measured pass
+  // does not depend on when the pager's threads get to them
+  for (auto i = 0; i < frames; ++i)
+  {
+    place_camera(viewer, path, (double)i / frames);
+    viewer.frame();
+
+    while (pager->getRequestsInProgress())
+    {
+      this_thread::sleep_for(chrono::milliseconds(1));
+      viewer.frame();
+    }
+  }
+
+  vector<unsigned> frame_numbers;
+  vector<double> frame_times;
+
+  for (auto i = 0; i < frames; ++i)
+  {
+    place_camera(viewer, path, (double)i / frames);
+
+    auto start = now();
+    viewer.frame();
+
+    frame_times.push_back((now() - start) * 1e3);
+    frame_numbers.push_back(viewer.getFrameStamp()->getFrameNumber());
+  }
+
+  // GPU timer queries are read back a few frames late
+  for (auto i = 0; i < STATS_LATENCY_FRAMES; ++i)
+    viewer.frame();
+
+  ObjectCountVisitor visitor;
+  root->accept(visitor);
+
+  PathResult result = {path.name, frames, visitor.get_total(), {}};
+
+  result.summaries.push_back({"frame_ms", summarize(frame_times)});
+
+  auto stats = viewer.getCamera()->getStats();
+
+  for (const auto& metric : METRICS)
+  {
+    vector<double> values;
+
+    for (auto frame_number : frame_numbers)
+    {
+      double value;
+
+      if (stats->getAttribute(frame_number, metric.attribute, value))
+	values.push_back(value * metric.scale);
+    }
+
+    result.summaries.push_back({metric.name, summarize(values)});
+  }
+
+  fprintf(
+    stderr, "%-24s %10.3f ms/frame  %zu objects\n",
+    path.name.c_str(), result.summaries[0].second.mean, result.objects);
+
+  results.push_back(result);
+}
+
+
+static void write_json(const string& filename, unsigned long long seed)
+{
+  auto file = fopen(filename.c_str(), "w");
+
+  if (!file)
+  {
+    fprintf(stderr, "Could not open %s\n", filename.c_str());
+    return;
+  }
+
+  fprintf(
+    file,
+    "{\n  \"seed\": %llu,\n  \"renderer\": \"%s\",\n"
+    "  \"width\": %d,\n  \"height\": %d,\n  \"paths\": [\n",
+    seed, renderer.c_str(), WIDTH, HEIGHT);
+
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const auto& result = results[i];
+
+    fprintf(
+      file, "    {\"name\": \"%s\", \"frames\": %d, \"objects\": %zu",
+      result.name.c_str(), result.frames, result.objects);
+
+    // Metrics the implementation does not provide, such as GPU time
+    // without timer queries, are written as null
+    for (const auto& key_value : result.summaries)
+    {
+      const auto& summary = key_value.second;
+
+      if (summary.count == 0)
+      {
+	fprintf(file, ",\n     \"%s\": null", key_value.first.c_str());
+	continue;
+      }
+
+      fprintf(
+	file,
+	",\n     \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f}",
+	key_value.first.c_str(), summary.mean, summary.p50, summary.p95, summary.max);
+    }
+
+    fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+  }
+
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+}
+
+
+int main(int argc, char** argv)
+{
+  string output = argc > 1 ? argv[1] : "render_benchmark.json";
+  auto frames = argc > 2 ? atoi(argv[2]) : 300;
+
+  const unsigned long long seed = SEED > 0 ? SEED : 1;
+
+  mt19937 rng(seed);
+  Input input;
+
+  unique_ptr<MapSystem> map_system(new MapSystem(rng));
+  EntitySystem entity_system(rng, input, *map_system);
+
+  ref_ptr<Group> root = new Group;
+  RenderSystem render_system(root, entity_system, *map_system);
+
+  auto context = create_context();
+
+  if (!context)
+  {
+    fprintf(stderr, "Could not create a pbuffer context\n");
+    return 1;
+  }
+
+  osgViewer::Viewer viewer;
+  viewer.setThreadingModel(osgViewer::ViewerBase::SingleThreaded);
+  viewer.setSceneData(root);
+  viewer.setRealizeOperation(new RendererOperation);
+
+  // Nothing expires while the benchmark runs
+  viewer.getDatabasePager()->setTargetMaximumNumberOfPageLOD(
+    CHUNKS_PER_SIDE * CHUNKS_PER_SIDE * NUM_FLOORS);
+
+  auto camera = viewer.getCamera();
+  camera->setGraphicsContext(context);
+  camera->setViewport(new Viewport(0, 0, WIDTH, HEIGHT));
+  camera->setProjectionMatrixAsPerspective(
+    FOV, (double)WIDTH / HEIGHT, NEAR_CLIP, FAR_CLIP);
+  camera->setDrawBuffer(GL_FRONT);
+  camera->setReadBuffer(GL_FRONT);
+
+  // History for both passes of every path plus the latency frames
+  auto paths = camera_paths();
+  auto history = paths.size() * (2 * frames + STATS_LATENCY_FRAMES) + 100;
+
+  camera->setStats(new Stats("Camera", history));
+  camera->getStats()->collectStats("rendering", true);
+  camera->getStats()->collectStats("gpu", true);
+  camera->getStats()->collectStats("scene", true);
+
+  viewer.realize();
+
+  for (const auto& path : paths)
+    bench_path(viewer, root, path, frames);
+
+  write_json(output, seed);
+
+  printf("Wrote %s (%s)\n", output.c_str(), renderer.c_str());
+}